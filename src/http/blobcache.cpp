@@ -0,0 +1,143 @@
+#include "blobcache.h"
+
+using namespace std;
+
+/* chrono::milliseconds 的构造按引用取参，需要类外定义 */
+const int BlobCache::REVALIDATE_MS;
+
+BlobCache::BlobCache(): budget_(0), maxFileSize_(64 * 1024), bytes_(0), hits_(0), misses_(0) {}
+
+BlobCache* BlobCache::Instance() {
+    static BlobCache inst;
+    return &inst;
+}
+
+void BlobCache::Init(size_t budget, size_t maxFileSize) {
+    Clear();
+    budget_ = budget;
+    maxFileSize_ = maxFileSize;
+    FileCache::Instance()->SkipMapUpTo(IsOpen() ? maxFileSize : 0);
+}
+
+void BlobCache::Clear() {
+    lock_guard<mutex> locker(mtx_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+shared_ptr<const ResponseBlob> BlobCache::Get(const string& path) {
+    if(!IsOpen()) { return nullptr; }
+    Clock::time_point now = Clock::now();
+    shared_ptr<const ResponseBlob> stale;
+    {
+        lock_guard<mutex> locker(mtx_);
+        auto it = index_.find(path);
+        if(it != index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            if(now < it->second->expires) {
+                hits_++;
+                return it->second->blob;
+            }
+            stale = it->second->blob;
+        }
+    }
+
+    /* 过期或未缓存: 由 FileCache 判断文件是否变化 */
+    shared_ptr<const FileEntry> file = FileCache::Instance()->Get(path);
+    if(stale && stale->file.lock() == file) {
+        lock_guard<mutex> locker(mtx_);
+        auto it = index_.find(path);
+        if(it != index_.end() && it->second->blob == stale) {
+            it->second->expires = now + chrono::milliseconds(REVALIDATE_MS);
+        }
+        hits_++;
+        return stale;
+    }
+    misses_++;
+    shared_ptr<const ResponseBlob> blob;
+    if(file->Exists() && file->Readable() && file->Size() <= maxFileSize_
+            && (file->Size() == 0 || file->blobBody)) {
+        blob = Build_(path, file);
+    }
+    Insert_(path, blob);
+    return blob;
+}
+
+shared_ptr<const ResponseBlob> BlobCache::Build_(const string& path, const shared_ptr<const FileEntry>& file) {
+    shared_ptr<ResponseBlob> blob = make_shared<ResponseBlob>();
+    if(file->Size() > 0) {
+        int fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) { return nullptr; }
+        /* 多读一个字节，用来发现文件在 stat 之后变长 */
+        blob->body.resize(file->Size() + 1);
+        size_t got = 0;
+        while(got < blob->body.size()) {
+            ssize_t n = read(fd, &blob->body[got], blob->body.size() - got);
+            if(n < 0 && errno == EINTR) { continue; }
+            if(n <= 0) { break; }
+            got += n;
+        }
+        close(fd);
+        if(got != file->Size()) { return nullptr; }
+        blob->body.resize(got);
+    }
+    /* 与 HttpResponse::AddStateLine_/AddHeader_ 的输出一致 */
+    blob->keepAliveHead = "HTTP/1.1 200 OK\r\nConnection: keep-alive\r\n"
+                          "keep-alive: max=6, timeout=120\r\n" + file->header;
+    blob->closeHead = "HTTP/1.1 200 OK\r\nConnection: close\r\n" + file->header;
+    blob->file = file;
+    return blob;
+}
+
+void BlobCache::Insert_(const string& path, const shared_ptr<const ResponseBlob>& blob) {
+    lock_guard<mutex> locker(mtx_);
+    auto it = index_.find(path);
+    if(it != index_.end()) {
+        if(it->second->blob) { bytes_ -= it->second->blob->Bytes(); }
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    /* 不可缓存(不存在、太大)的文件不占位，交给常规路径处理 */
+    if(!blob || blob->Bytes() > budget_) { return; }
+    lru_.push_front({ path, blob, Clock::now() + chrono::milliseconds(REVALIDATE_MS) });
+    index_[path] = lru_.begin();
+    bytes_ += blob->Bytes();
+    while(bytes_ > budget_) {
+        /* 淘汰最久未用的项，正在发送它的连接仍持有引用 */
+        Node& victim = lru_.back();
+        bytes_ -= victim.blob->Bytes();
+        index_.erase(victim.path);
+        lru_.pop_back();
+    }
+}
+
+int BlobCache::Preload(const string& srcDir) {
+    int count = 0;
+    if(IsOpen()) {
+        PreloadDir_(srcDir, "", &count);
+    }
+    return count;
+}
+
+void BlobCache::PreloadDir_(const string& srcDir, const string& rel, int* count) {
+    DIR* dir = opendir((srcDir + rel).data());
+    if(!dir) { return; }
+    struct dirent* ent;
+    while((ent = readdir(dir)) != nullptr) {
+        string name = ent->d_name;
+        if(name == "." || name == "..") { continue; }
+        /* 键与请求时 srcDir + path 的拼法一致，path 以 '/' 开头 */
+        string child = rel + "/" + name;
+        struct stat st;
+        if(stat((srcDir + child).data(), &st) < 0) { continue; }
+        if(S_ISDIR(st.st_mode)) {
+            PreloadDir_(srcDir, child, count);
+        }
+        else if(S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) <= maxFileSize_
+                && bytes_ + st.st_size <= budget_) {
+            if(Get(srcDir + child)) { (*count)++; }
+        }
+    }
+    closedir(dir);
+}
@@ -0,0 +1,89 @@
+#ifndef BLOB_CACHE_H
+#define BLOB_CACHE_H
+
+#include <unordered_map>
+#include <list>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <dirent.h>      // opendir, readdir
+#include <sys/stat.h>
+#include <assert.h>
+
+#include "filecache.h"
+
+/* 小文件的完整 200 响应，构建后只读，由 shared_ptr 在连接间共享。
+ * 状态行+头部按 keep-alive 与否各备一份，文件体是 read() 读出的唯一一份副本
+ * (FileCache 对这些文件不再映射)，发送时两段直接交给 writev，不再拼响应头。
+ * 不从映射里拷贝: 文件在缓存期间被截短时，用户态读映射会收到 SIGBUS。 */
+struct ResponseBlob {
+    const std::string& Head(bool isKeepAlive) const {
+        return isKeepAlive ? keepAliveHead : closeHead;
+    }
+    size_t Bytes() const {
+        return keepAliveHead.size() + closeHead.size() + body.size();
+    }
+
+    std::string keepAliveHead;
+    std::string closeHead;
+    std::string body;
+    std::weak_ptr<const FileEntry> file;  // 构建时对应的缓存项，用于判断文件是否变化，不延长映射的生命期
+};
+
+/* 小文件响应缓存: 路径 -> ResponseBlob，按总字节数做 LRU 淘汰。
+ * 文件是否变化交给 FileCache 判断(TTL + stat)，本缓存只在 FileCache
+ * 返回了新的缓存项时重建对应的响应。 */
+class BlobCache {
+public:
+    static BlobCache* Instance();
+
+    /* budget 为 0 时关闭，maxFileSize 以上的文件不进缓存 */
+    void Init(size_t budget, size_t maxFileSize);
+
+    std::shared_ptr<const ResponseBlob> Get(const std::string& path);
+
+    /* 递归预加载 srcDir 下的小文件，返回加载的个数 */
+    int Preload(const std::string& srcDir);
+
+    void Clear();
+
+    bool IsOpen() const { return budget_ > 0; }
+    size_t Bytes() const { return bytes_; }
+    size_t Hits() const { return hits_; }
+    size_t Misses() const { return misses_; }
+
+private:
+    BlobCache();
+    ~BlobCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Node {
+        std::string path;
+        std::shared_ptr<const ResponseBlob> blob;
+        Clock::time_point expires;
+    };
+
+    /* 读文件失败或读到的长度与缓存项不符(文件正在变化)时返回 nullptr */
+    std::shared_ptr<const ResponseBlob> Build_(const std::string& path, const std::shared_ptr<const FileEntry>& file);
+    void Insert_(const std::string& path, const std::shared_ptr<const ResponseBlob>& blob);
+    void PreloadDir_(const std::string& srcDir, const std::string& rel, int* count);
+
+    /* 与 FileCache 的默认 TTL 一致，未过期的项连 FileCache 都不查 */
+    static const int REVALIDATE_MS = 2000;
+
+    std::mutex mtx_;
+    std::list<Node> lru_;   // 表头最近使用
+    std::unordered_map<std::string, std::list<Node>::iterator> index_;
+
+    size_t budget_;
+    size_t maxFileSize_;
+    std::atomic<size_t> bytes_;
+
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+};
+
+#endif //BLOB_CACHE_H
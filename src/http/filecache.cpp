@@ -0,0 +1,139 @@
+#include "filecache.h"
+#include "httpresponse.h"
+
+using namespace std;
+
+FileEntry::~FileEntry() {
+    if(mmFile) {
+        munmap(mmFile, mmLen);
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+FileCache::FileCache(): ttl_(2000), maxEntries_(4096), blobMax_(0), hits_(0), misses_(0) {}
+
+FileCache* FileCache::Instance() {
+    static FileCache inst;
+    return &inst;
+}
+
+void FileCache::Init(int ttlMS, size_t maxEntries) {
+    Clear();
+    ttl_ = chrono::milliseconds(ttlMS);
+    maxEntries_ = maxEntries;
+}
+
+void FileCache::SkipMapUpTo(size_t size) {
+    Clear();
+    blobMax_ = size;
+}
+
+void FileCache::Clear() {
+    for(int i = 0; i < SHARD_NUM; i++) {
+        lock_guard<mutex> locker(shards_[i].mtx);
+        shards_[i].files.clear();
+    }
+}
+
+bool FileCache::SameFile_(const struct stat& a, const struct stat& b) {
+    return a.st_ino == b.st_ino && a.st_dev == b.st_dev && a.st_size == b.st_size
+        && a.st_mode == b.st_mode
+        && a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+shared_ptr<const FileEntry> FileCache::Get(const string& path) {
+    if(ttl_.count() <= 0) {
+        /* 关闭缓存 */
+        misses_++;
+        return Load_(path, nullptr);
+    }
+    Shard& shard = shards_[hash<string>()(path) % SHARD_NUM];
+    Clock::time_point now = Clock::now();
+    shared_ptr<const FileEntry> stale;
+    {
+        lock_guard<mutex> locker(shard.mtx);
+        auto it = shard.files.find(path);
+        if(it != shard.files.end()) {
+            if(now < it->second.expires) {
+                hits_++;
+                return it->second.entry;
+            }
+            stale = it->second.entry;
+        }
+    }
+
+    /* 过期: stat 一次确认文件是否变化 */
+    struct stat st;
+    int ret = stat(path.data(), &st);
+    int err = ret < 0 ? errno : 0;
+    if(stale && stale->err == err && (err != 0 || SameFile_(st, stale->st))) {
+        lock_guard<mutex> locker(shard.mtx);
+        auto it = shard.files.find(path);
+        if(it != shard.files.end() && it->second.entry == stale) {
+            it->second.expires = now + ttl_;
+        }
+        hits_++;
+        return stale;
+    }
+
+    misses_++;
+    shared_ptr<const FileEntry> entry = Load_(path, ret == 0 ? &st : nullptr);
+    lock_guard<mutex> locker(shard.mtx);
+    auto it = shard.files.find(path);
+    if(it == shard.files.end() && shard.files.size() >= maxEntries_ / SHARD_NUM + 1) {
+        /* 满了先清掉过期项，还满就不缓存这一项 */
+        for(auto iter = shard.files.begin(); iter != shard.files.end(); ) {
+            if(iter->second.expires <= now) { iter = shard.files.erase(iter); }
+            else { ++iter; }
+        }
+        if(shard.files.size() >= maxEntries_ / SHARD_NUM + 1) {
+            return entry;
+        }
+    }
+    shard.files[path] = { entry, now + ttl_ };
+    return entry;
+}
+
+shared_ptr<const FileEntry> FileCache::Load_(const string& path, const struct stat* st) {
+    shared_ptr<FileEntry> entry = make_shared<FileEntry>();
+    if(st) {
+        entry->st = *st;
+    }
+    else if(stat(path.data(), &entry->st) < 0) {
+        entry->err = errno;
+        return entry;
+    }
+    if(!entry->Exists() || !entry->Readable()) {
+        return entry;
+    }
+
+    entry->mimeType = HttpResponse::FileType(path);
+    entry->header = "Content-type: " + entry->mimeType + "\r\n"
+                  + "Content-length: " + to_string(entry->Size()) + "\r\n\r\n";
+    if(entry->Size() == 0) {
+        return entry;
+    }
+    if(entry->Size() <= blobMax_) {
+        /* 文件体由 BlobCache 读出保存，这里再映射一份只会占双份内存 */
+        entry->blobBody = true;
+        return entry;
+    }
+    int srcFd = open(path.data(), O_RDONLY | O_CLOEXEC);
+    if(srcFd < 0) {
+        return entry;
+    }
+    if(entry->Size() >= HttpResponse::sendfileThreshold) {
+        /* 大文件保留 fd，各连接用自己的 offset 调 sendfile，互不影响 */
+        entry->fd = srcFd;
+        return entry;
+    }
+    void* mmRet = mmap(0, entry->Size(), PROT_READ, MAP_PRIVATE, srcFd, 0);
+    close(srcFd);
+    if(mmRet != MAP_FAILED) {
+        entry->mmFile = static_cast<char*>(mmRet);
+        entry->mmLen = entry->Size();
+    }
+    return entry;
+}
@@ -0,0 +1,88 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <unordered_map>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>       // open
+#include <unistd.h>      // close
+#include <sys/stat.h>    // stat
+#include <sys/mman.h>    // mmap, munmap
+#include <assert.h>
+
+/* 一个静态资源的缓存项，创建后只读，由 shared_ptr 在连接间共享。
+ * 小文件只保留一份只读映射，大文件保留打开的 fd 供 sendfile 使用；
+ * 开启 BlobCache 时，它能缓存的文件在这里不映射，文件体只在 BlobCache 中存一份 read() 的副本。
+ * 缓存项被替换或淘汰后，仍在发送它的连接持有引用直到发送完毕。 */
+struct FileEntry {
+    FileEntry(): err(0), fd(-1), mmFile(nullptr), mmLen(0), blobBody(false) { st = { 0 }; }
+    ~FileEntry();
+
+    bool Exists() const { return err == 0 && !S_ISDIR(st.st_mode); }
+    bool Readable() const { return st.st_mode & S_IROTH; }
+    size_t Size() const { return st.st_size; }
+
+    int err;               // stat/open 失败时的 errno，0 表示成功
+    struct stat st;
+    int fd;                // 走 sendfile 的文件，否则为 -1
+    char* mmFile;          // 走 mmap 的文件，否则为 nullptr
+    size_t mmLen;
+    bool blobBody;         // 文件体由 BlobCache 保存，这里既无映射也无 fd
+    std::string mimeType;
+    std::string header;    // 预先拼好的 "Content-type ... Content-length ...\r\n\r\n"
+};
+
+/* 进程内共享的静态文件缓存: 路径 -> 打开的 fd / 映射、stat 结果、MIME 和响应头。
+ * 按 TTL 失效: 过期后 stat 一次，文件没变则续期，变了则重新加载。
+ * 命中时不产生任何文件系统调用。 */
+class FileCache {
+public:
+    static FileCache* Instance();
+
+    void Init(int ttlMS, size_t maxEntries);
+
+    /* 不超过 size 的文件不做映射(文件体交给 BlobCache)，0 表示都映射。由 BlobCache::Init 设置，会清空缓存 */
+    void SkipMapUpTo(size_t size);
+
+    std::shared_ptr<const FileEntry> Get(const std::string& path);
+
+    void Clear();
+
+    size_t Hits() const { return hits_; }
+    size_t Misses() const { return misses_; }
+
+private:
+    FileCache();
+    ~FileCache() = default;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Node {
+        std::shared_ptr<const FileEntry> entry;
+        Clock::time_point expires;
+    };
+
+    /* 分段加锁，减少工作线程之间的竞争 */
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, Node> files;
+    };
+
+    std::shared_ptr<const FileEntry> Load_(const std::string& path, const struct stat* st);
+    static bool SameFile_(const struct stat& a, const struct stat& b);
+
+    static const int SHARD_NUM = 16;
+
+    Shard shards_[SHARD_NUM];
+    std::chrono::milliseconds ttl_;
+    size_t maxEntries_;
+    size_t blobMax_;
+
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+};
+
+#endif //FILE_CACHE_H
@@ -0,0 +1,116 @@
+#include "handlers.h"
+
+using namespace std;
+
+namespace {
+/* 路径里是否有 ".." 段，有则可能跳出 srcDir。请求路径不做百分号解码，只需检查字面值 */
+bool HasParentSegment(const string& path) {
+    size_t pos = 0;
+    while(pos < path.size()) {
+        size_t end = path.find('/', pos);
+        if(end == string::npos) { end = path.size(); }
+        if(end - pos == 2 && path.compare(pos, 2, "..") == 0) { return true; }
+        pos = end + 1;
+    }
+    return false;
+}
+}
+
+void StaticHandler::Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) {
+    if(HasParentSegment(request.path())) {
+        LOG_WARN("Reject path with '..': %s", request.path().c_str());
+        reply->Error(403);
+        return;
+    }
+    reply->File(request.path());
+}
+
+void FileHandler::Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) {
+    reply->File(path_);
+}
+
+void UserHandler::Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) {
+    if(UserVerify_(request.GetPost("username"), request.GetPost("password"), isLogin_)) {
+        reply->File("/welcome.html");
+    } 
+    else {
+        reply->File("/error.html");
+    }
+}
+
+bool UserHandler::UserVerify_(const string &name, const string &pwd, bool isLogin) {
+    if(name == "" || pwd == "") { return false; }
+    LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
+    MYSQL* sql;
+    SqlConnRAII(&sql,  SqlConnPool::Instance());
+    assert(sql);
+    
+    bool flag = false;
+    char order[256] = { 0 };
+    MYSQL_RES *res = nullptr;
+    
+    if(!isLogin) { flag = true; }
+    /* 查询用户及密码 */
+    snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
+    LOG_DEBUG("%s", order);
+
+    if(mysql_query(sql, order)) { 
+        mysql_free_result(res);
+        return false; 
+    }
+    res = mysql_store_result(sql);
+
+    while(MYSQL_ROW row = mysql_fetch_row(res)) {
+        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
+        string password(row[1]);
+        /* 注册行为 且 用户名未被使用*/
+        if(isLogin) {
+            if(pwd == password) { flag = true; }
+            else {
+                flag = false;
+                LOG_DEBUG("pwd error!");
+            }
+        } 
+        else { 
+            flag = false; 
+            LOG_DEBUG("user used!");
+        }
+    }
+    mysql_free_result(res);
+
+    /* 注册行为 且 用户名未被使用*/
+    if(!isLogin && flag == true) {
+        LOG_DEBUG("regirster!");
+        bzero(order, 256);
+        snprintf(order, 256,"INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
+        LOG_DEBUG( "%s", order);
+        if(mysql_query(sql, order)) { 
+            LOG_DEBUG( "Insert error!");
+            flag = false; 
+        }
+        flag = true;
+    }
+    SqlConnPool::Instance()->FreeConn(sql);
+    LOG_DEBUG( "UserVerify success!!");
+    return flag;
+}
+
+void RegisterDefaultRoutes(Router* router) {
+    static const char* PAGES[] = { "/index", "/register", "/login", "/welcome", "/video", "/picture" };
+    router->Add("GET", "/", make_shared<FileHandler>("/index.html"));
+    for(const char* page: PAGES) {
+        router->Add("GET", page, make_shared<FileHandler>(string(page) + ".html"));
+    }
+
+    auto login = make_shared<UserHandler>(true);
+    auto reg = make_shared<UserHandler>(false);
+    router->Add("POST", "/login", login);
+    router->Add("POST", "/login.html", login);
+    router->Add("POST", "/register", reg);
+    router->Add("POST", "/register.html", reg);
+
+    /* 其余路径按静态文件处理，POST 沿用以前的行为直接回复页面 */
+    auto files = make_shared<StaticHandler>();
+    router->Add("GET", "/*path", files);
+    router->Add("POST", "/*path", files);
+}
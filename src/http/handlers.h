@@ -0,0 +1,42 @@
+#ifndef HANDLERS_H
+#define HANDLERS_H
+
+#include <string>
+#include <mysql/mysql.h>  //mysql
+
+#include "../pool/sqlconnpool.h"
+#include "../pool/sqlconnRAII.h"
+#include "router.h"
+
+/* 静态资源: "*path" 通配到的路径原样映射到 srcDir 下，含 ".." 段的回复 403 */
+class StaticHandler : public HttpHandler {
+public:
+    void Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) override;
+};
+
+/* 固定回复某个资源文件，如 "/" -> "/index.html" */
+class FileHandler : public HttpHandler {
+public:
+    explicit FileHandler(const std::string& path): path_(path) {}
+    void Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) override;
+
+private:
+    std::string path_;
+};
+
+/* 登录/注册表单: 校验通过回复 welcome 页，否则 error 页 */
+class UserHandler : public HttpHandler {
+public:
+    explicit UserHandler(bool isLogin): isLogin_(isLogin) {}
+    void Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) override;
+
+private:
+    static bool UserVerify_(const std::string& name, const std::string& pwd, bool isLogin);
+
+    bool isLogin_;
+};
+
+/* 注册内置路由: 首页、登录注册等页面和静态资源兜底 */
+void RegisterDefaultRoutes(Router* router);
+
+#endif //HANDLERS_H
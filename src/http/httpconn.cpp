@@ -4,13 +4,24 @@ using namespace std;
 const char* HttpConn::srcDir;
 std::atomic<int> HttpConn::userCount;
 bool HttpConn::isET;
+int HttpConn::pipelineDepth = 16;
 
 HttpConn::HttpConn() { 
     fd_ = -1;
     addr_ = { 0 };
     isClose_ = true;
+    keepAlive_ = false;
+    awaitBody_ = false;
+    lastActive_ = 0;
+    readUs_ = 0;
+    iovIdx_ = 0;
+    iovLeft_ = 0;
+    fileOffset_ = 0;
+    fileLeft_ = 0;
+    chunked_ = false;
 };
 
+
 HttpConn::~HttpConn() { 
     Close(); 
 };
@@ -22,17 +33,29 @@ void HttpConn::init(int fd, const sockaddr_in& addr) {
     fd_ = fd;
     writeBuff_.RetrieveAll();
     readBuff_.RetrieveAll();
+    /* 槽位复用，丢弃上一个连接残留的解析状态 */
+    request_.Init();
+    ClearBatch_();
     isClose_ = false;
-    LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
+    if(AccessLog::Instance()->IsOpen()) {
+        AccessLog::Instance()->Connect(fd_, addr_, userCount);
+    } else {
+        LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
+    }
 }
 
 void HttpConn::Close() {
     response_.UnmapFile();
+    ClearBatch_();
     if(isClose_ == false){
         isClose_ = true; 
         userCount--;
         close(fd_);
-        LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
+        if(AccessLog::Instance()->IsOpen()) {
+            AccessLog::Instance()->Close(fd_, addr_, userCount);
+        } else {
+            LOG_INFO("Client[%d](%s:%d) quit, UserCount:%d", fd_, GetIP(), GetPort(), (int)userCount);
+        }
     }
 }
 
@@ -53,6 +76,9 @@ int HttpConn::GetPort() const {
 }
 
 ssize_t HttpConn::read(int* saveErrno) {
+    if(AccessLog::Instance()->IsOpen()) {
+        readUs_ = AccessLog::NowUs();
+    }
     ssize_t len = -1;
     do {
         len = readBuff_.ReadFd(fd_, saveErrno);
@@ -65,54 +91,222 @@ ssize_t HttpConn::read(int* saveErrno) {
 
 ssize_t HttpConn::write(int* saveErrno) {
     ssize_t len = -1;
+    int chunks = 0;
     do {
-        len = writev(fd_, iov_, iovCnt_);
+        if(iovLeft_ == 0 && fileLeft_ == 0 && producer_) {
+            /* 每次最多拉取若干段，避免一个永远可写的长流独占线程，剩下的等下一次可写 */
+            if(chunks++ == MAX_CHUNKS_PER_WRITE || !NextChunk_()) { break; }
+        }
+        if(iovLeft_ == 0) {
+            /* 没有待发的文件体(调用时已经写完)，不能碰 sendFile_ */
+            if(fileLeft_ == 0 || !sendFile_) { break; }
+            /* 响应头已发完，剩下的文件体走 sendfile，offset 记录断点 */
+            len = sendfile(fd_, sendFile_->fd, &fileOffset_, fileLeft_);
+            if(len < 0) {
+                *saveErrno = errno;
+                break;
+            }
+            if(len == 0) {
+                /* 文件在缓存期间被截短，剩下的字节永远读不到，errno 是旧值，按 EIO 关闭连接 */
+                *saveErrno = EIO;
+                len = -1;
+                break;
+            }
+            fileLeft_ -= len;
+            if(fileLeft_ == 0) { break; } /* 传输结束 */
+            continue;
+        }
+        struct msghdr msg = {};
+        msg.msg_iov = &iov_[iovIdx_];
+        msg.msg_iovlen = std::min(iov_.size() - iovIdx_, static_cast<size_t>(IOV_MAX));
+        /* 后面还有 sendfile 的文件体时带 MSG_MORE，让响应头和文件首段合并发出 */
+        len = sendmsg(fd_, &msg, MSG_NOSIGNAL | (fileLeft_ > 0 ? MSG_MORE : 0));
         if(len <= 0) {
             *saveErrno = errno;
             break;
         }
-        if(iov_[0].iov_len + iov_[1].iov_len  == 0) { break; } /* 传输结束 */
-        else if(static_cast<size_t>(len) > iov_[0].iov_len) {
-            iov_[1].iov_base = (uint8_t*) iov_[1].iov_base + (len - iov_[0].iov_len);
-            iov_[1].iov_len -= (len - iov_[0].iov_len);
-            if(iov_[0].iov_len) {
-                writeBuff_.RetrieveAll();
-                iov_[0].iov_len = 0;
-            }
+        iovLeft_ -= len;
+        size_t n = len;
+        while(iovIdx_ < iov_.size() && n >= iov_[iovIdx_].iov_len) {
+            n -= iov_[iovIdx_].iov_len;
+            iovIdx_++;
         }
-        else {
-            iov_[0].iov_base = (uint8_t*)iov_[0].iov_base + len; 
-            iov_[0].iov_len -= len; 
-            writeBuff_.Retrieve(len);
+        if(n > 0) {
+            iov_[iovIdx_].iov_base = (uint8_t*)iov_[iovIdx_].iov_base + n;
+            iov_[iovIdx_].iov_len -= n;
         }
+        if(ToWriteBytes() == 0) { break; } /* 传输结束 */
     } while(isET || ToWriteBytes() > 10240);
     return len;
 }
 
-bool HttpConn::process() {
-    request_.Init();
-    if(readBuff_.ReadableBytes() <= 0) {
-        return false;
+void HttpConn::ClearBatch_() {
+    iov_.clear();
+    buffIov_.clear();
+    iovIdx_ = 0;
+    iovLeft_ = 0;
+    blobs_.clear();
+    files_.clear();
+    sendFile_.reset();
+    fileOffset_ = 0;
+    fileLeft_ = 0;
+    producer_ = nullptr;
+    awaitBody_ = false;
+    writeBuff_.RetrieveAll();
+}
+
+/* 向生产者拉取下一段正文，按需加上分块头尾，放进 iov_ */
+bool HttpConn::NextChunk_() {
+    if(!streamBuff_) {
+        streamBuff_.reset(new Buffer(16 * 1024));
+    }
+    streamBuff_->RetrieveAll();
+    bool more = producer_(*streamBuff_);
+    size_t len = streamBuff_->ReadableBytes();
+    if(more && len == 0) {
+        LOG_WARN("Client[%d] stream produced an empty chunk, end it", fd_);
+        more = false;
     }
-    else if(request_.parse(readBuff_)) {
-        LOG_DEBUG("%s", request_.path().c_str());
-        response_.Init(srcDir, request_.path(), request_.IsKeepAlive(), 200);
+    iov_.clear();
+    iovIdx_ = 0;
+    iovLeft_ = 0;
+    if(chunked_ && len > 0) {
+        int n = snprintf(chunkHead_, sizeof(chunkHead_), "%zx\r\n", len);
+        AddIov_(chunkHead_, n);
+        AddIov_(streamBuff_->Peek(), len);
+        AddIov_("\r\n", 2);
     } else {
-        response_.Init(srcDir, request_.path(), false, 400);
+        AddIov_(streamBuff_->Peek(), len);
+    }
+    if(!more) {
+        if(chunked_) { AddIov_("0\r\n\r\n", 5); }
+        producer_ = nullptr;
+    }
+    return iovLeft_ > 0;
+}
+
+/* 从 headOff 起新追加到 writeBuff_ 的内容作为一个 iov，
+ * 先记偏移，后续追加可能使 writeBuff_ 扩容，本批组装完再填地址 */
+void HttpConn::AddHead_(size_t headOff) {
+    assert(writeBuff_.ReadableBytes() > headOff);
+    buffIov_.push_back(iov_.size());
+    AddIov_(reinterpret_cast<const char*>(headOff), writeBuff_.ReadableBytes() - headOff);
+}
+
+void HttpConn::AddIov_(const char* base, size_t len) {
+    if(len == 0) { return; }
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(base);
+    iov.iov_len = len;
+    iov_.push_back(iov);
+    iovLeft_ += len;
+}
+
+/* 按 reply_ 把一个响应排进本批，返回 true 表示本批到此结束:
+ * 流式响应、走 sendfile 的文件体或不保持连接。
+ * HEAD 只排头部: 不挂文件体、不拉流，否则客户端会把正文当成下一个响应 */
+bool HttpConn::AddReply_(int* status) {
+    *status = reply_.code;
+    bool head = reply_.head;
+    if(reply_.kind == HttpReply::STREAM) {
+        /* 流式响应，HTTP/1.0 不支持分块，正文以关闭连接结束 */
+        chunked_ = request_.version() == "1.1";
+        keepAlive_ = keepAlive_ && chunked_;
+        response_.Init(srcDir, reply_.path, keepAlive_, reply_.code, head);
+        size_t headOff = writeBuff_.ReadableBytes();
+        response_.MakeStreamHead(writeBuff_, reply_.contentType, chunked_);
+        AddHead_(headOff);
+        if(head) { return !keepAlive_; }
+        producer_ = std::move(reply_.producer);
+        return true;
+    }
+    if(reply_.kind == HttpReply::CONTENT) {
+        response_.Init(srcDir, reply_.path, keepAlive_, reply_.code, head);
+        size_t headOff = writeBuff_.ReadableBytes();
+        response_.MakeContentResponse(writeBuff_, reply_.contentType, reply_.content);
+        AddHead_(headOff);
+        return !keepAlive_;
     }
 
+    if(reply_.code == 200) {
+        std::shared_ptr<const ResponseBlob> blob = BlobCache::Instance()->Get(srcDir + reply_.path);
+        if(blob) {
+            /* 预先构建好的完整响应，头和体直接进 iov_ */
+            const std::string& blobHead = blob->Head(keepAlive_);
+            AddIov_(blobHead.data(), blobHead.size());
+            if(!head) { AddIov_(blob->body.data(), blob->body.size()); }
+            blobs_.push_back(std::move(blob));
+            return !keepAlive_;
+        }
+    }
+    response_.Init(srcDir, reply_.path, keepAlive_, reply_.code, head);
+    response_.SetAllow(reply_.allow);
+    size_t headOff = writeBuff_.ReadableBytes();
     response_.MakeResponse(writeBuff_);
-    /* 响应头 */
-    iov_[0].iov_base = const_cast<char*>(writeBuff_.Peek());
-    iov_[0].iov_len = writeBuff_.ReadableBytes();
-    iovCnt_ = 1;
+    AddHead_(headOff);
+    *status = response_.Code();
+
+    if(head) { return !keepAlive_; }
 
     /* 文件 */
-    if(response_.FileLen() > 0  && response_.File()) {
-        iov_[1].iov_base = response_.File();
-        iov_[1].iov_len = response_.FileLen();
-        iovCnt_ = 2;
+    if(response_.FileLen() > 0 && response_.File()) {
+        AddIov_(response_.File(), response_.FileLen());
+        files_.push_back(response_.Entry());
+        if(response_.Blob()) { blobs_.push_back(response_.Blob()); }
+    }
+    else if(response_.FileLen() > 0 && response_.FileFd() >= 0) {
+        sendFile_ = response_.Entry();
+        fileLeft_ = response_.FileLen();
+        return true;
     }
-    LOG_DEBUG("filesize:%d, %d  to %d", response_.FileLen() , iovCnt_, ToWriteBytes());
+    return !keepAlive_;
+}
+
+/* 处理 readBuff_ 中所有完整的请求(至多 pipelineDepth 个)，响应按顺序排队，
+ * 没有完整请求时返回 false。出错、要求关闭或走 sendfile 的响应结束本批。 */
+bool HttpConn::process() {
+    ClearBatch_();
+    int count = 0;
+    while(count < pipelineDepth && readBuff_.ReadableBytes() > 0) {
+        HttpRequest::PARSE_RESULT ret = request_.parse(readBuff_);
+        if(ret == HttpRequest::NEED_MORE) {
+            if(request_.TakeContinue()) {
+                /* 客户端在等 100 才发请求体，排在本批已有响应之后 */
+                static const char CONTINUE[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                AddIov_(CONTINUE, sizeof(CONTINUE) - 1);
+                /* 是否保持连接仍按请求本身，100 发完后靠 awaitBody_ 留住连接收请求体 */
+                keepAlive_ = request_.IsKeepAlive();
+                awaitBody_ = true;
+            }
+            break;
+        }
+        count++;
+        keepAlive_ = request_.IsKeepAlive();
+        if(ret == HttpRequest::COMPLETE) {
+            LOG_DEBUG("%s %s", request_.method().c_str(), request_.path().c_str());
+            Router::Instance()->Dispatch(request_, &params_, &reply_);
+        } else {
+            reply_.Clear();
+            reply_.Error(request_.ErrorCode());
+            keepAlive_ = false;
+        }
+
+        size_t queued = iovLeft_ + fileLeft_;
+        int status = 0;
+        bool last = AddReply_(&status);
+        if(AccessLog::Instance()->IsOpen()) {
+            AccessLog::Instance()->Request(fd_, addr_, request_.method(), request_.path(), status,
+                                           iovLeft_ + fileLeft_ - queued, AccessLog::NowUs() - readUs_);
+        }
+        if(last) { break; }
+    }
+    response_.UnmapFile();
+    if(iov_.empty() && fileLeft_ == 0) {
+        return false;
+    }
+    for(size_t i: buffIov_) {
+        iov_[i].iov_base = const_cast<char*>(writeBuff_.Peek()) + reinterpret_cast<size_t>(iov_[i].iov_base);
+    }
+    LOG_DEBUG("pipeline %d requests, %d iov, %d bytes", count, (int)iov_.size(), ToWriteBytes());
     return true;
-}
\ No newline at end of file
+}
@@ -3,15 +3,24 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>     // readv/writev
+#include <sys/socket.h>  // sendmsg
+#include <sys/sendfile.h> // sendfile
 #include <arpa/inet.h>   // sockaddr_in
 #include <stdlib.h>      // atoi()
 #include <errno.h>      
+#include <limits.h>      // IOV_MAX
+#include <vector>
+#include <memory>
+#include <unordered_map>
 
 #include "../log/log.h"
+#include "../log/accesslog.h"
 #include "../pool/sqlconnRAII.h"
 #include "../buffer/buffer.h"
 #include "httprequest.h"
 #include "httpresponse.h"
+#include "blobcache.h"
+#include "router.h"
 
 class HttpConn {
 public:
@@ -37,15 +46,24 @@ public:
     
     bool process();
 
+    /* 流式响应还没结束时至少算 1 字节，调用者据此继续等待可写 */
     int ToWriteBytes() { 
-        return iov_[0].iov_len + iov_[1].iov_len; 
+        return iovLeft_ + fileLeft_ + (producer_ ? 1 : 0); 
     }
 
+    /* 本批写完后是否保留连接: 最后一个请求要求保持连接，或已回 100 还在等请求体 */
     bool IsKeepAlive() const {
-        return request_.IsKeepAlive();
+        return keepAlive_ || awaitBody_;
     }
 
+    /* 最后一次读写事件的时间(毫秒)，只由连接所属的事件循环线程读写，
+     * 超时定时器到期时据此判断是否真的空闲 */
+    void Touch(int64_t nowMs) { lastActive_ = nowMs; }
+    int64_t LastActive() const { return lastActive_; }
+
     static bool isET;
+    /* 一批最多处理的流水线请求数 */
+    static int pipelineDepth;
     static const char* srcDir;
     static std::atomic<int> userCount;
     
@@ -55,9 +73,44 @@ private:
     struct  sockaddr_in addr_;
 
     bool isClose_;
+    bool keepAlive_;
+    bool awaitBody_;    // 本批以 100 Continue 结束，请求体还没到
+    int64_t lastActive_;
+    int64_t readUs_;    // 最后一次读数据的时间(微秒)，只在开启二进制访问日志时记录
+
+    void ClearBatch_();
+    bool AddReply_(int* status);
+    void AddIov_(const char* base, size_t len);
+    bool NextChunk_();
+    void AddHead_(size_t headOff);
     
-    int iovCnt_;
-    struct iovec iov_[2];
+    /* 一批流水线响应按顺序排成 iov_，一次 sendmsg 聚集写出，iovIdx_ 之前的已发完。
+     * 响应头在 writeBuff_ 中，文件体指向缓存(响应缓存的 blob 或共享映射)。 */
+    std::vector<struct iovec> iov_;
+    size_t iovIdx_;
+    size_t iovLeft_;
+    std::vector<size_t> buffIov_;  // 指向 writeBuff_ 的 iov 下标，批次组装完再填地址
+
+    /* 本批响应引用的缓存项，发完前保持存活 */
+    std::vector<std::shared_ptr<const ResponseBlob>> blobs_;
+    std::vector<std::shared_ptr<const FileEntry>> files_;
+
+    /* sendfile 发送的文件体: 只能是一批的最后一个响应，iov_ 发完后从 fileOffset_ 继续 */
+    std::shared_ptr<const FileEntry> sendFile_;
+    off_t fileOffset_;
+    size_t fileLeft_;
+
+    /* 流式响应: 同样只能是一批的最后一个，头部发完后每次 iov_ 排空再拉取下一段，
+     * 写不动时不再拉取，生产者的速度由 socket 可写的节奏决定 */
+    HttpResponse::BodyProducer producer_;
+    bool chunked_;
+    std::unique_ptr<Buffer> streamBuff_;
+    char chunkHead_[20];
+    static const int MAX_CHUNKS_PER_WRITE = 16;
+
+    /* 路由分发的输出，每个请求复用 */
+    RouteParams params_;
+    HttpReply reply_;
     
     Buffer readBuff_; // 读缓冲区
     Buffer writeBuff_; // 写缓冲区
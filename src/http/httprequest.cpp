@@ -1,106 +1,426 @@
 #include "httprequest.h"
 using namespace std;
 
-const unordered_set<string> HttpRequest::DEFAULT_HTML{
-            "/index", "/register", "/login",
-             "/welcome", "/video", "/picture", };
+size_t HttpRequest::maxHeaderSize = 16 * 1024;
+size_t HttpRequest::maxBodySize = 8 * 1024 * 1024;
+size_t HttpRequest::spoolThreshold = 64 * 1024;
+string HttpRequest::spoolDir = "/tmp";
+function<HttpRequest::BodyHandler(const HttpRequest&)> HttpRequest::bodyHandlerFactory;
 
-const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
-            {"/register.html", 0}, {"/login.html", 1},  };
+HttpRequest::~HttpRequest() {
+    if(spoolFd_ >= 0) { close(spoolFd_); }
+}
 
 void HttpRequest::Init() {
     method_ = path_ = version_ = body_ = "";
     state_ = REQUEST_LINE;
-    header_.clear();
+    pos_ = 0;
+    scan_ = 0;
+    errCode_ = 0;
+    keepAlive_ = false;
+    chunked_ = false;
+    isForm_ = false;
+    expectContinue_ = false;
+    contentLength_ = 0;
+    bodyLeft_ = 0;
+    bodyLen_ = 0;
+    handler_ = nullptr;
+    if(spoolFd_ >= 0) {
+        close(spoolFd_);
+        spoolFd_ = -1;
+    }
+    headerCnt_ = 0;
+    trailerCnt_ = 0;
+    trailerBytes_ = 0;
     post_.clear();
 }
 
 bool HttpRequest::IsKeepAlive() const {
-    if(header_.count("Connection") == 1) {
-        return header_.find("Connection")->second == "keep-alive" && version_ == "1.1";
-    }
-    return false;
+    return keepAlive_;
 }
 
-bool HttpRequest::parse(Buffer& buff) {
-    const char CRLF[] = "\r\n";
-    if(buff.ReadableBytes() <= 0) {
-        return false;
+/* 按行推进的状态机: 行内逐字节校验，头部切片只记偏移，不拷贝。
+ * 头部完整之前不取走缓冲区中的数据，头部结束时把需要留存的字段物化再一次性取走，
+ * 之后的请求体边解析边取走，交给内存中的 body_、临时文件或流式回调。
+ * 数据不完整时返回 NEED_MORE 并保留状态和位置，下次读到新数据后从断点继续。 */
+HttpRequest::PARSE_RESULT HttpRequest::parse(Buffer& buff) {
+    if(state_ == FINISH || errCode_) {
+        /* 上一个请求已结束，开始解析下一个 */
+        Init();
     }
-    while(buff.ReadableBytes() && state_ != FINISH) {
-        const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
-        std::string line(buff.Peek(), lineEnd);
-        switch(state_)
-        {
-        case REQUEST_LINE:
-            if(!ParseRequestLine_(line)) {
-                return false;
+    while(state_ != FINISH) {
+        const char* base = buff.Peek();
+        size_t end = buff.ReadableBytes();
+        if(state_ == BODY || state_ == CHUNK_DATA) {
+            size_t n = min(end, bodyLeft_);
+            if(n == 0) {
+                return NEED_MORE;
             }
-            ParsePath_();
-            break;    
-        case HEADERS:
-            ParseHeader_(line);
-            if(buff.ReadableBytes() <= 2) {
-                state_ = FINISH;
+            if(!AppendBody_(base, n)) {
+                return ERROR;
             }
+            buff.Retrieve(n);
+            bodyLeft_ -= n;
+            if(bodyLeft_ == 0) {
+                state_ = (state_ == BODY) ? FINISH : CHUNK_DATA_END;
+            }
+            continue;
+        }
+
+        /* 其余状态都按行处理 */
+        size_t from = max(scan_, pos_);
+        const char* lf = static_cast<const char*>(memchr(base + from, '\n', end - from));
+        if(!lf) {
+            scan_ = end;
+            if(state_ == REQUEST_LINE && end - pos_ > MAX_URI_LEN + 1024) {
+                Error_(414);
+                return ERROR;
+            }
+            if((state_ == REQUEST_LINE || state_ == HEADERS) && end > maxHeaderSize) {
+                Error_(431);
+                return ERROR;
+            }
+            if(state_ != REQUEST_LINE && state_ != HEADERS && end - pos_ > MAX_CHUNK_LINE) {
+                Error_(400);
+                return ERROR;
+            }
+            return NEED_MORE;
+        }
+        size_t begin = pos_;
+        size_t lineEnd = lf - base;
+        if(state_ == HEADERS && lineEnd >= maxHeaderSize) {
+            Error_(431);
+            return ERROR;
+        }
+        pos_ = lineEnd + 1;
+        /* 行尾 CRLF，容忍只有 LF 的客户端 */
+        if(lineEnd > begin && base[lineEnd - 1] == '\r') {
+            lineEnd--;
+        }
+        bool ok = true;
+        switch(state_) {
+        case REQUEST_LINE:
+            ok = ParseRequestLine_(base, begin, lineEnd);
+            break;
+        case HEADERS:
+            ok = ParseHeader_(base, begin, lineEnd);
+            break;
+        case CHUNK_SIZE:
+            ok = ParseChunkSize_(base, begin, lineEnd);
+            break;
+        case CHUNK_DATA_END:
+            ok = (begin == lineEnd) ? true : Error_(400);
+            state_ = CHUNK_SIZE;
             break;
-        case BODY:
-            ParseBody_(line);
+        case CHUNK_TRAILER:
+            /* trailer 内容忽略，但和头部一样限制行数与总字节数，防止无休止地发 trailer */
+            if(begin == lineEnd) { state_ = FINISH; }
+            else if(++trailerCnt_ > MAX_HEADERS) { ok = Error_(431); }
+            else if((trailerBytes_ += pos_ - begin) > maxHeaderSize) { ok = Error_(431); }
             break;
         default:
             break;
         }
-        if(lineEnd == buff.BeginWrite()) { break; }
-        buff.RetrieveUntil(lineEnd + 2);
+        if(!ok) {
+            return ERROR;
+        }
+        if(state_ != REQUEST_LINE && state_ != HEADERS) {
+            /* 头部之后的数据已不再被切片引用，解析一段取走一段 */
+            buff.Retrieve(pos_);
+            pos_ = scan_ = 0;
+        }
+    }
+
+    if(handler_ && !handler_(nullptr, 0)) {
+        Error_(500);
+        return ERROR;
+    }
+    ParsePost_();
+    LOG_DEBUG("[%s], [%s], [%s], body:%d", method_.c_str(), path_.c_str(), version_.c_str(), (int)bodyLen_);
+    return COMPLETE;
+}
+
+bool HttpRequest::Error_(int code) {
+    errCode_ = code;
+    /* 出错后连接必须关闭，剩余数据无法再可靠地划分出请求 */
+    keepAlive_ = false;
+    LOG_WARN("Bad request: %d", code);
+    return false;
+}
+
+bool HttpRequest::IsTokenChar_(char ch) {
+    /* RFC 7230 tchar */
+    if(isalnum(static_cast<unsigned char>(ch))) { return true; }
+    switch(ch) {
+    case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+    case '+': case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool HttpRequest::EqualsNoCase_(const char* s, size_t len, const char* lit) {
+    return strlen(lit) == len && strncasecmp(s, lit, len) == 0;
+}
+
+bool HttpRequest::HasToken_(const char* s, size_t len, const char* token) {
+    /* 逗号分隔的列表，如 "keep-alive, Upgrade" */
+    size_t i = 0;
+    while(i < len) {
+        while(i < len && (s[i] == ' ' || s[i] == '\t' || s[i] == ',')) { i++; }
+        size_t j = i;
+        while(j < len && s[j] != ',') { j++; }
+        size_t e = j;
+        while(e > i && (s[e - 1] == ' ' || s[e - 1] == '\t')) { e--; }
+        if(e > i && EqualsNoCase_(s + i, e - i, token)) { return true; }
+        i = j;
+    }
+    return false;
+}
+
+const Slice* HttpRequest::FindHeader_(const char* base, const char* name) const {
+    for(int i = 0; i < headerCnt_; i++) {
+        if(EqualsNoCase_(base + headerName_[i].off, headerName_[i].len, name)) {
+            return &headerValue_[i];
+        }
+    }
+    return nullptr;
+}
+
+bool HttpRequest::ParseRequestLine_(const char* base, size_t begin, size_t end) {
+    if(begin == end) {
+        /* 请求行之前的空行忽略 */
+        return true;
+    }
+    size_t i = begin;
+    while(i < end && IsTokenChar_(base[i])) { i++; }
+    if(i == begin || i >= end || base[i] != ' ') {
+        return Error_(400);
+    }
+    methodSlice_ = { static_cast<uint32_t>(begin), static_cast<uint32_t>(i - begin) };
+
+    size_t uri = ++i;
+    while(i < end && base[i] != ' ') {
+        unsigned char ch = base[i];
+        if(ch < 0x21 || ch == 0x7f) {
+            return Error_(400);
+        }
+        i++;
+    }
+    if(i - uri > MAX_URI_LEN) {
+        return Error_(414);
+    }
+    if(i == uri || i >= end || base[uri] != '/') {
+        return Error_(400);
+    }
+    uriSlice_ = { static_cast<uint32_t>(uri), static_cast<uint32_t>(i - uri) };
+
+    i++;
+    if(end - i < 5 || memcmp(base + i, "HTTP/", 5) != 0) {
+        return Error_(400);
+    }
+    if(end - i != 8 || base[i + 6] != '.' || (memcmp(base + i + 5, "1.1", 3) != 0
+                                            && memcmp(base + i + 5, "1.0", 3) != 0)) {
+        return Error_(505);
+    }
+    versionSlice_ = { static_cast<uint32_t>(i + 5), 3 };
+    state_ = HEADERS;
+    return true;
+}
+
+bool HttpRequest::ParseHeader_(const char* base, size_t begin, size_t end) {
+    if(begin == end) {
+        return EndOfHeaders_(base);
+    }
+    size_t i = begin;
+    while(i < end && IsTokenChar_(base[i])) { i++; }
+    /* 名字后不允许空白，也不支持已废弃的折行 */
+    if(i == begin || i >= end || base[i] != ':') {
+        return Error_(400);
+    }
+    if(headerCnt_ == MAX_HEADERS) {
+        return Error_(431);
+    }
+    size_t name = begin, nameLen = i - begin;
+    i++;
+    while(i < end && (base[i] == ' ' || base[i] == '\t')) { i++; }
+    size_t e = end;
+    while(e > i && (base[e - 1] == ' ' || base[e - 1] == '\t')) { e--; }
+    for(size_t k = i; k < e; k++) {
+        unsigned char ch = base[k];
+        if((ch < 0x20 && ch != '\t') || ch == 0x7f) {
+            return Error_(400);
+        }
     }
-    LOG_DEBUG("[%s], [%s], [%s]", method_.c_str(), path_.c_str(), version_.c_str());
+    headerName_[headerCnt_] = { static_cast<uint32_t>(name), static_cast<uint32_t>(nameLen) };
+    headerValue_[headerCnt_] = { static_cast<uint32_t>(i), static_cast<uint32_t>(e - i) };
+    headerCnt_++;
     return true;
 }
 
-void HttpRequest::ParsePath_() {
-    if(path_ == "/") {
-        path_ = "/index.html"; 
+bool HttpRequest::EndOfHeaders_(const char* base) {
+    /* 切片即将随缓冲区取走而失效，先物化要留存的字段 */
+    method_.assign(base + methodSlice_.off, methodSlice_.len);
+    version_.assign(base + versionSlice_.off, versionSlice_.len);
+    /* 查询串不参与静态资源定位 */
+    const char* uri = base + uriSlice_.off;
+    const char* query = static_cast<const char*>(memchr(uri, '?', uriSlice_.len));
+    path_.assign(uri, query ? query - uri : uriSlice_.len);
+
+    bool http11 = base[versionSlice_.off + 2] == '1';
+    const Slice* conn = FindHeader_(base, "Connection");
+    if(http11) {
+        /* HTTP/1.1 默认长连接 */
+        keepAlive_ = !(conn && HasToken_(base + conn->off, conn->len, "close"));
+    } else {
+        keepAlive_ = conn && HasToken_(base + conn->off, conn->len, "keep-alive");
+    }
+
+    const Slice* type = FindHeader_(base, "Content-Type");
+    if(type) {
+        /* 忽略 "; charset=..." 之类的参数 */
+        const char* value = base + type->off;
+        const char* semi = static_cast<const char*>(memchr(value, ';', type->len));
+        size_t len = semi ? semi - value : type->len;
+        while(len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) { len--; }
+        isForm_ = EqualsNoCase_(value, len, "application/x-www-form-urlencoded");
     }
-    else {
-        for(auto &item: DEFAULT_HTML) {
-            if(item == path_) {
-                path_ += ".html";
-                break;
+
+    /* 请求体定界: Transfer-Encoding 与 Content-Length 同时出现视为走私请求 */
+    const Slice* te = FindHeader_(base, "Transfer-Encoding");
+    bool hasLength = false;
+    contentLength_ = 0;
+    for(int i = 0; i < headerCnt_; i++) {
+        if(!EqualsNoCase_(base + headerName_[i].off, headerName_[i].len, "Content-Length")) {
+            continue;
+        }
+        const Slice& cl = headerValue_[i];
+        if(cl.len == 0 || cl.len > 18) {
+            return Error_(400);
+        }
+        size_t len = 0;
+        for(size_t k = 0; k < cl.len; k++) {
+            char ch = base[cl.off + k];
+            if(ch < '0' || ch > '9') {
+                return Error_(400);
             }
+            len = len * 10 + (ch - '0');
+        }
+        /* 多个 Content-Length 必须一致 */
+        if(hasLength && len != contentLength_) {
+            return Error_(400);
+        }
+        hasLength = true;
+        contentLength_ = len;
+    }
+    if(te) {
+        if(hasLength || !http11) {
+            return Error_(400);
+        }
+        if(!EqualsNoCase_(base + te->off, te->len, "chunked")) {
+            return Error_(501);
+        }
+        chunked_ = true;
+    }
+    if(contentLength_ > maxBodySize) {
+        /* 不等请求体到达就拒绝 */
+        return Error_(413);
+    }
+
+    if(chunked_ || contentLength_ > 0) {
+        const Slice* expect = FindHeader_(base, "Expect");
+        if(expect) {
+            if(!http11 || !EqualsNoCase_(base + expect->off, expect->len, "100-continue")) {
+                return Error_(417);
+            }
+            expectContinue_ = true;
+        }
+        if(bodyHandlerFactory) {
+            handler_ = bodyHandlerFactory(*this);
         }
     }
+    bodyLeft_ = contentLength_;
+    if(chunked_) {
+        state_ = CHUNK_SIZE;
+    } else {
+        state_ = contentLength_ > 0 ? BODY : FINISH;
+    }
+    return true;
 }
 
-bool HttpRequest::ParseRequestLine_(const string& line) {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {   
-        method_ = subMatch[1];
-        path_ = subMatch[2];
-        version_ = subMatch[3];
-        state_ = HEADERS;
-        return true;
+bool HttpRequest::ParseChunkSize_(const char* base, size_t begin, size_t end) {
+    /* 十六进制长度，后面可能跟 ";ext=..." 扩展，忽略 */
+    size_t size = 0;
+    size_t i = begin;
+    for(; i < end; i++) {
+        char ch = base[i];
+        int digit;
+        if(ch >= '0' && ch <= '9') { digit = ch - '0'; }
+        else if(ch >= 'a' && ch <= 'f') { digit = ch - 'a' + 10; }
+        else if(ch >= 'A' && ch <= 'F') { digit = ch - 'A' + 10; }
+        else { break; }
+        if(size > (maxBodySize >> 4)) {
+            return Error_(413);
+        }
+        size = (size << 4) | digit;
     }
-    LOG_ERROR("RequestLine Error");
-    return false;
+    if(i == begin || (i < end && base[i] != ';' && base[i] != ' ' && base[i] != '\t')) {
+        return Error_(400);
+    }
+    if(bodyLen_ + size > maxBodySize) {
+        return Error_(413);
+    }
+    if(size == 0) {
+        state_ = CHUNK_TRAILER;
+    } else {
+        bodyLeft_ = size;
+        state_ = CHUNK_DATA;
+    }
+    return true;
 }
 
-void HttpRequest::ParseHeader_(const string& line) {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch subMatch;
-    if(regex_match(line, subMatch, patten)) {
-        header_[subMatch[1]] = subMatch[2];
+bool HttpRequest::AppendBody_(const char* data, size_t len) {
+    bodyLen_ += len;
+    if(bodyLen_ > maxBodySize) {
+        return Error_(413);
     }
-    else {
-        state_ = BODY;
+    if(handler_) {
+        return handler_(data, len) ? true : Error_(500);
+    }
+    if(spoolFd_ < 0 && body_.size() + len <= spoolThreshold) {
+        body_.append(data, len);
+        return true;
     }
+    return Spool_(data, len);
 }
 
-void HttpRequest::ParseBody_(const string& line) {
-    body_ = line;
-    ParsePost_();
-    state_ = FINISH;
-    LOG_DEBUG("Body:%s, len:%d", line.c_str(), line.size());
+bool HttpRequest::Spool_(const char* data, size_t len) {
+    if(spoolFd_ < 0) {
+        /* 大请求体转存到匿名临时文件，已缓存的部分先写入 */
+        string path = spoolDir + "/webserver-body-XXXXXX";
+        spoolFd_ = mkstemp(&path[0]);
+        if(spoolFd_ < 0) {
+            LOG_ERROR("Create spool file in %s error: %d", spoolDir.c_str(), errno);
+            return Error_(500);
+        }
+        unlink(path.data());
+        if(!Spool_(body_.data(), body_.size())) {
+            return false;
+        }
+        body_.clear();
+    }
+    while(len > 0) {
+        ssize_t n = write(spoolFd_, data, len);
+        if(n < 0) {
+            if(errno == EINTR) { continue; }
+            LOG_ERROR("Write spool file error: %d", errno);
+            return Error_(500);
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
 }
 
 int HttpRequest::ConverHex(char ch) {
@@ -110,21 +430,9 @@ int HttpRequest::ConverHex(char ch) {
 }
 
 void HttpRequest::ParsePost_() {
-    if(method_ == "POST" && header_["Content-Type"] == "application/x-www-form-urlencoded") {
+    /* 转存到文件或交给回调的请求体不在这里解析 */
+    if(isForm_ && spoolFd_ < 0 && !handler_) {
         ParseFromUrlencoded_();
-        if(DEFAULT_HTML_TAG.count(path_)) {
-            int tag = DEFAULT_HTML_TAG.find(path_)->second;
-            LOG_DEBUG("Tag:%d", tag);
-            if(tag == 0 || tag == 1) {
-                bool isLogin = (tag == 1);
-                if(UserVerify(post_["username"], post_["password"], isLogin)) {
-                    path_ = "/welcome.html";
-                } 
-                else {
-                    path_ = "/error.html";
-                }
-            }
-        }
     }   
 }
 
@@ -169,79 +477,18 @@ void HttpRequest::ParseFromUrlencoded_() {
     }
 }
 
-bool HttpRequest::UserVerify(const string &name, const string &pwd, bool isLogin) {
-    if(name == "" || pwd == "") { return false; }
-    LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII(&sql,  SqlConnPool::Instance());
-    assert(sql);
-    
-    bool flag = false;
-    unsigned int j = 0;
-    char order[256] = { 0 };
-    MYSQL_FIELD *fields = nullptr;
-    MYSQL_RES *res = nullptr;
-    
-    if(!isLogin) { flag = true; }
-    /* 查询用户及密码 */
-    snprintf(order, 256, "SELECT username, password FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", order);
-
-    if(mysql_query(sql, order)) { 
-        mysql_free_result(res);
-        return false; 
-    }
-    res = mysql_store_result(sql);
-    j = mysql_num_fields(res);
-    fields = mysql_fetch_fields(res);
-
-    while(MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        string password(row[1]);
-        /* 注册行为 且 用户名未被使用*/
-        if(isLogin) {
-            if(pwd == password) { flag = true; }
-            else {
-                flag = false;
-                LOG_DEBUG("pwd error!");
-            }
-        } 
-        else { 
-            flag = false; 
-            LOG_DEBUG("user used!");
-        }
-    }
-    mysql_free_result(res);
-
-    /* 注册行为 且 用户名未被使用*/
-    if(!isLogin && flag == true) {
-        LOG_DEBUG("regirster!");
-        bzero(order, 256);
-        snprintf(order, 256,"INSERT INTO user(username, password) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG( "%s", order);
-        if(mysql_query(sql, order)) { 
-            LOG_DEBUG( "Insert error!");
-            flag = false; 
-        }
-        flag = true;
-    }
-    SqlConnPool::Instance()->FreeConn(sql);
-    LOG_DEBUG( "UserVerify success!!");
-    return flag;
-}
-
-std::string HttpRequest::path() const{
+const std::string& HttpRequest::path() const{
     return path_;
 }
 
 std::string& HttpRequest::path(){
     return path_;
 }
-std::string HttpRequest::method() const {
+const std::string& HttpRequest::method() const {
     return method_;
 }
 
-std::string HttpRequest::version() const {
+const std::string& HttpRequest::version() const {
     return version_;
 }
 
@@ -2,51 +2,88 @@
 #define HTTP_REQUEST_H
 
 #include <unordered_map>
-#include <unordered_set>
 #include <string>
-#include <regex>
+#include <functional>
+#include <stdint.h>
+#include <stdlib.h>    // mkstemp
+#include <unistd.h>    // write, unlink
+#include <string.h>    // memchr
+#include <strings.h>   // strncasecmp
+#include <ctype.h>
 #include <errno.h>     
-#include <mysql/mysql.h>  //mysql
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
-#include "../pool/sqlconnpool.h"
-#include "../pool/sqlconnRAII.h"
+
+/* C++14 没有 std::string_view: 读缓冲区中的一段，相对请求起点(Peek())的偏移，
+ * 缓冲区扩容或整理后仍然有效 */
+struct Slice {
+    uint32_t off;
+    uint32_t len;
+};
 
 class HttpRequest {
 public:
     enum PARSE_STATE {
         REQUEST_LINE,
         HEADERS,
-        BODY,
+        BODY,           // Content-Length 定长请求体
+        CHUNK_SIZE,     // chunked: 块长度行
+        CHUNK_DATA,
+        CHUNK_DATA_END, // 块数据后的 CRLF
+        CHUNK_TRAILER,  // 末块之后的 trailer，忽略
         FINISH,        
     };
 
-    enum HTTP_CODE {
-        NO_REQUEST = 0,
-        GET_REQUEST,
-        BAD_REQUEST,
-        NO_RESOURSE,
-        FORBIDDENT_REQUEST,
-        FILE_REQUEST,
-        INTERNAL_ERROR,
-        CLOSED_CONNECTION,
+    enum PARSE_RESULT {
+        NEED_MORE = 0,   // 请求还不完整，等待更多数据
+        COMPLETE,        // 解析出一个完整请求，已从缓冲区取走
+        ERROR,           // 请求非法，ErrorCode() 给出响应状态码
     };
     
-    HttpRequest() { Init(); }
-    ~HttpRequest() = default;
+    /* 流式接收请求体: 数据逐段交给回调，结束时以 (nullptr, 0) 调用一次，返回 false 中止请求(500) */
+    typedef std::function<bool(const char* data, size_t len)> BodyHandler;
+
+    HttpRequest(): spoolFd_(-1) { Init(); }
+    ~HttpRequest();
 
     void Init();
-    bool parse(Buffer& buff);
+    PARSE_RESULT parse(Buffer& buff);
 
-    std::string path() const;
+    const std::string& path() const;
     std::string& path();
-    std::string method() const;
-    std::string version() const;
+    const std::string& method() const;
+    const std::string& version() const;
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
 
     bool IsKeepAlive() const;
+    int ErrorCode() const { return errCode_; }
+
+    /* 声明的请求体长度，chunked 时为 -1 */
+    long long ContentLength() const { return chunked_ ? -1 : static_cast<long long>(contentLength_); }
+    /* 已接收的请求体字节数 */
+    size_t BodyLength() const { return bodyLen_; }
+    const std::string& body() const { return body_; }
+    /* 请求体超过 spoolThreshold 时落盘到匿名临时文件，否则为 -1 */
+    int BodyFd() const { return spoolFd_; }
+
+    /* 客户端带了 Expect: 100-continue 且在等待，取走标记后由调用者回复 100 */
+    bool TakeContinue() {
+        bool ret = expectContinue_;
+        expectContinue_ = false;
+        return ret;
+    }
+
+    /* 请求行加全部头部的字节上限，超过返回 431 */
+    static size_t maxHeaderSize;
+    /* 请求体上限，超过返回 413；声明的长度超限时不等请求体到达就回复 */
+    static size_t maxBodySize;
+    /* 请求体超过该值时转存到 spoolDir 下的临时文件 */
+    static size_t spoolThreshold;
+    static std::string spoolDir;
+    /* 头部解析完后调用，返回非空回调时请求体交给回调而不在内存中缓存 */
+    static std::function<BodyHandler(const HttpRequest&)> bodyHandlerFactory;
 
     /* 
     todo 
@@ -55,23 +92,51 @@ public:
     */
 
 private:
-    bool ParseRequestLine_(const std::string& line);
-    void ParseHeader_(const std::string& line);
-    void ParseBody_(const std::string& line);
+    bool ParseRequestLine_(const char* base, size_t begin, size_t end);
+    bool ParseHeader_(const char* base, size_t begin, size_t end);
+    bool EndOfHeaders_(const char* base);
+    bool ParseChunkSize_(const char* base, size_t begin, size_t end);
+    bool AppendBody_(const char* data, size_t len);
+    bool Spool_(const char* data, size_t len);
+    bool Error_(int code);
 
-    void ParsePath_();
     void ParsePost_();
     void ParseFromUrlencoded_();
 
-    static bool UserVerify(const std::string& name, const std::string& pwd, bool isLogin);
+    const Slice* FindHeader_(const char* base, const char* name) const;
+    static bool IsTokenChar_(char ch);
+    static bool EqualsNoCase_(const char* s, size_t len, const char* lit);
+    static bool HasToken_(const char* s, size_t len, const char* token);
+
+    static const int MAX_HEADERS = 100;     // 头部行数上限，超过返回 431；总字节数另由 maxHeaderSize 限制
+    static const size_t MAX_URI_LEN = 8192;
+    static const size_t MAX_CHUNK_LINE = 1024;
 
     PARSE_STATE state_;
+    size_t pos_;        // 当前行的起点(相对 Peek())，之前的行都已解析
+    size_t scan_;       // 当前行内已找过换行符的位置，数据分多次到达时不重复扫描
+    int errCode_;
+    bool keepAlive_;
+    bool chunked_;
+    bool isForm_;
+    bool expectContinue_;
+    size_t contentLength_;
+    size_t bodyLeft_;   // 当前定长体或当前块还差的字节数
+    size_t bodyLen_;
+    BodyHandler handler_;
+    int spoolFd_;
+
+    /* 头部解析期间的切片，头部结束时用到的部分物化为下面的 string */
+    Slice methodSlice_, uriSlice_, versionSlice_;
+    Slice headerName_[MAX_HEADERS];
+    Slice headerValue_[MAX_HEADERS];
+    int headerCnt_;
+    int trailerCnt_;
+    size_t trailerBytes_;
+
     std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;
     std::unordered_map<std::string, std::string> post_;
 
-    static const std::unordered_set<std::string> DEFAULT_HTML;
-    static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
     static int ConverHex(char ch);
 };
 
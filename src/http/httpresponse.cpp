@@ -29,8 +29,18 @@ const unordered_map<int, string> HttpResponse::CODE_STATUS = {
     { 400, "Bad Request" },
     { 403, "Forbidden" },
     { 404, "Not Found" },
+    { 405, "Method Not Allowed" },
+    { 413, "Payload Too Large" },
+    { 414, "URI Too Long" },
+    { 417, "Expectation Failed" },
+    { 431, "Request Header Fields Too Large" },
+    { 500, "Internal Server Error" },
+    { 501, "Not Implemented" },
+    { 505, "HTTP Version Not Supported" },
 };
 
+size_t HttpResponse::sendfileThreshold = 256 * 1024;
+
 const unordered_map<int, string> HttpResponse::CODE_PATH = {
     { 400, "/400.html" },
     { 403, "/403.html" },
@@ -41,35 +51,37 @@ HttpResponse::HttpResponse() {
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
-    mmFile_ = nullptr; 
-    mmFileStat_ = { 0 };
+    isHead_ = false;
 };
 
 HttpResponse::~HttpResponse() {
     UnmapFile();
 }
 
-void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code){
+void HttpResponse::Init(const string& srcDir, string& path, bool isKeepAlive, int code, bool isHead){
     assert(srcDir != "");
-    if(mmFile_) { UnmapFile(); }
+    UnmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
+    isHead_ = isHead;
+    allow_.clear();
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr; 
-    mmFileStat_ = { 0 };
 }
 
 void HttpResponse::MakeResponse(Buffer& buff) {
-    /* 判断请求的资源文件 */
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
-        code_ = 404;
-    }
-    else if(!(mmFileStat_.st_mode & S_IROTH)) {
-        code_ = 403;
-    }
-    else if(code_ == -1) { 
-        code_ = 200; 
+    /* 判断请求的资源文件，请求本身出错时不再查找 */
+    if(code_ < 400) {
+        file_ = FileCache::Instance()->Get(srcDir_ + path_);
+        if(!file_->Exists()) {
+            code_ = 404;
+        }
+        else if(!file_->Readable()) {
+            code_ = 403;
+        }
+        else if(code_ == -1) { 
+            code_ = 200; 
+        }
     }
     ErrorHtml_();
     AddStateLine_(buff);
@@ -77,18 +89,46 @@ void HttpResponse::MakeResponse(Buffer& buff) {
     AddContent_(buff);
 }
 
-char* HttpResponse::File() {
-    return mmFile_;
+void HttpResponse::MakeStreamHead(Buffer& buff, const string& contentType, bool chunked) {
+    file_.reset();
+    if(!chunked) {
+        isKeepAlive_ = false;
+    }
+    AddStateLine_(buff);
+    AddHeader_(buff);
+    buff.Append("Content-type: " + contentType + "\r\n");
+    if(chunked) {
+        buff.Append("Transfer-Encoding: chunked\r\n");
+    }
+    buff.Append("\r\n");
+}
+
+void HttpResponse::MakeContentResponse(Buffer& buff, const string& contentType, const string& content) {
+    file_.reset();
+    AddStateLine_(buff);
+    AddHeader_(buff);
+    buff.Append("Content-type: " + contentType + "\r\n");
+    buff.Append("Content-length: " + to_string(content.size()) + "\r\n\r\n");
+    if(!isHead_) { buff.Append(content); }
+}
+
+const char* HttpResponse::File() const {
+    if(blob_) { return blob_->body.data(); }
+    return file_ ? file_->mmFile : nullptr;
 }
 
 size_t HttpResponse::FileLen() const {
-    return mmFileStat_.st_size;
+    return file_ ? file_->Size() : 0;
 }
 
 void HttpResponse::ErrorHtml_() {
     if(CODE_PATH.count(code_) == 1) {
         path_ = CODE_PATH.find(code_)->second;
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        file_ = FileCache::Instance()->Get(srcDir_ + path_);
+    }
+    else if(code_ >= 400) {
+        /* 没有对应的错误页，由 ErrorContent 生成 */
+        file_.reset();
     }
 }
 
@@ -112,43 +152,42 @@ void HttpResponse::AddHeader_(Buffer& buff) {
     } else{
         buff.Append("close\r\n");
     }
-    buff.Append("Content-type: " + GetFileType_() + "\r\n");
+    if(!allow_.empty()) {
+        buff.Append("Allow: " + allow_ + "\r\n");
+    }
 }
 
 void HttpResponse::AddContent_(Buffer& buff) {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
-    if(srcFd < 0) { 
-        ErrorContent(buff, "File NotFound!");
-        return; 
+    if(file_ && file_->blobBody) {
+        /* 错误页等不走 HttpConn 整块响应的情况，文件体同样取 BlobCache 里的那份；
+         * 长度与本次的缓存项对不上(文件刚变化)时按取不到处理，避免 Content-length 与正文不一致 */
+        blob_ = BlobCache::Instance()->Get(srcDir_ + path_);
+        if(blob_ && blob_->body.size() != file_->Size()) { blob_.reset(); }
     }
-
-    /* 将文件映射到内存提高文件的访问速度 
-        MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
-    int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    if(*mmRet == -1) {
+    if(!file_ || !file_->Exists() || (file_->Size() > 0 && !File() && file_->fd < 0)) {
+        /* ErrorContent 生成的是 html，与请求路径的后缀无关 */
+        buff.Append("Content-type: text/html\r\n");
         ErrorContent(buff, "File NotFound!");
+        file_.reset();
         return; 
     }
-    mmFile_ = (char*)mmRet;
-    close(srcFd);
-    buff.Append("Content-length: " + to_string(mmFileStat_.st_size) + "\r\n\r\n");
+    LOG_DEBUG("file path %s", (srcDir_ + path_).data());
+    /* Content-type 与 Content-length 由缓存预先拼好 */
+    buff.Append(file_->header);
 }
 
 void HttpResponse::UnmapFile() {
-    if(mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
-    }
+    file_.reset();
+    blob_.reset();
 }
 
-string HttpResponse::GetFileType_() {
+string HttpResponse::FileType(const string& path) {
     /* 判断文件类型 */
-    string::size_type idx = path_.find_last_of('.');
+    string::size_type idx = path.find_last_of('.');
     if(idx == string::npos) {
         return "text/plain";
     }
-    string suffix = path_.substr(idx);
+    string suffix = path.substr(idx);
     if(SUFFIX_TYPE.count(suffix) == 1) {
         return SUFFIX_TYPE.find(suffix)->second;
     }
@@ -171,5 +210,5 @@ void HttpResponse::ErrorContent(Buffer& buff, string message)
     body += "<hr><em>TinyWebServer</em></body></html>";
 
     buff.Append("Content-length: " + to_string(body.size()) + "\r\n\r\n");
-    buff.Append(body);
+    if(!isHead_) { buff.Append(body); }
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
+#include <memory>
+#include <functional>
 #include <fcntl.h>       // open
 #include <unistd.h>      // close
 #include <sys/stat.h>    // stat
@@ -9,19 +11,40 @@
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "filecache.h"
+#include "blobcache.h"
 
 class HttpResponse {
 public:
+    /* 流式响应的正文生产者: 每次被调用向 out 追加一段正文，返回 false 表示这是最后一段。
+     * 只在上一段写完、socket 可写时才会被再次调用 */
+    typedef std::function<bool(Buffer& out)> BodyProducer;
+
     HttpResponse();
     ~HttpResponse();
 
-    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
+    /* isHead: HEAD 请求，头部(含 Content-length)与 GET 相同，不附带正文 */
+    void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1,
+              bool isHead = false);
     void MakeResponse(Buffer& buff);
+    /* 只生成状态行和头部，正文由调用者向 BodyProducer 逐段拉取；不分块时正文以关闭连接结束 */
+    void MakeStreamHead(Buffer& buff, const std::string& contentType, bool chunked);
+    /* 处理器生成的内联正文 */
+    void MakeContentResponse(Buffer& buff, const std::string& contentType, const std::string& content);
     void UnmapFile();
-    char* File();
+    /* 文件体: FileCache 的映射，或 BlobCache 里的副本 */
+    const char* File() const;
+    int FileFd() const { return file_ ? file_->fd : -1; }
+    const std::shared_ptr<const FileEntry>& Entry() const { return file_; }
+    /* 文件体在 BlobCache 中时持有对应的响应，发送完之前要保持引用 */
+    const std::shared_ptr<const ResponseBlob>& Blob() const { return blob_; }
     size_t FileLen() const;
     void ErrorContent(Buffer& buff, std::string message);
     int Code() const { return code_; }
+    /* 405 的 Allow 头，Init 时清空 */
+    void SetAllow(const std::string& methods) { allow_ = methods; }
+
+    static std::string FileType(const std::string& path);
 
 private:
     void AddStateLine_(Buffer &buff);
@@ -29,20 +52,26 @@ private:
     void AddContent_(Buffer &buff);
 
     void ErrorHtml_();
-    std::string GetFileType_();
 
     int code_;
     bool isKeepAlive_;
+    bool isHead_;
+    std::string allow_;
 
     std::string path_;
     std::string srcDir_;
     
-    char* mmFile_; 
-    struct stat mmFileStat_;
+    /* 来自 FileCache 的共享缓存项: 小文件是只读映射，大文件是给 sendfile 的 fd */
+    std::shared_ptr<const FileEntry> file_;
+    std::shared_ptr<const ResponseBlob> blob_;
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
     static const std::unordered_map<int, std::string> CODE_STATUS;
     static const std::unordered_map<int, std::string> CODE_PATH;
+
+public:
+    /* 文件大小不小于该值时走 sendfile 零拷贝，否则 mmap + writev */
+    static size_t sendfileThreshold;
 };
 
 
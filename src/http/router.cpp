@@ -0,0 +1,206 @@
+#include "router.h"
+
+using namespace std;
+
+const string& RouteParams::Get(const string& name) const {
+    static const string EMPTY;
+    for(auto& item: params_) {
+        if(*item.first == name) { return item.second; }
+    }
+    return EMPTY;
+}
+
+namespace {
+/* 把普通函数包装成处理器 */
+class FuncHandler : public HttpHandler {
+public:
+    explicit FuncHandler(Router::HandlerFunc func): func_(std::move(func)) {}
+    void Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) override {
+        func_(request, params, reply);
+    }
+private:
+    Router::HandlerFunc func_;
+};
+}
+
+Router* Router::Instance() {
+    static Router inst;
+    return &inst;
+}
+
+void Router::Add(const string& method, const string& pattern, shared_ptr<HttpHandler> handler) {
+    assert(handler);
+    if(pattern.empty() || pattern[0] != '/') {
+        LOG_ERROR("Route %s %s: pattern must start with '/'", method.c_str(), pattern.c_str());
+        return;
+    }
+    size_t wild = pattern.find('*');
+    if(wild != string::npos && pattern.find('/', wild) != string::npos) {
+        LOG_ERROR("Route %s %s: wildcard must be the last segment", method.c_str(), pattern.c_str());
+        return;
+    }
+    routes_.push_back({ method, pattern, std::move(handler) });
+    compiled_ = false;
+}
+
+void Router::Add(const string& method, const string& pattern, HandlerFunc func) {
+    Add(method, pattern, make_shared<FuncHandler>(std::move(func)));
+}
+
+void Router::Compile() {
+    nodes_.clear();
+    NewNode_("");
+    for(auto& route: routes_) {
+        Insert_(route);
+    }
+    compiled_ = true;
+    LOG_INFO("Router: %d routes, %d trie nodes", (int)routes_.size(), (int)nodes_.size());
+}
+
+int Router::NewNode_(const string& prefix) {
+    nodes_.emplace_back();
+    nodes_.back().prefix = prefix;
+    return static_cast<int>(nodes_.size()) - 1;
+}
+
+void Router::Insert_(const Route& route) {
+    const string& pat = route.pattern;
+    size_t pos = 0;
+    int n = 0;
+    /* nodes_ 可能扩容，全程只持有下标 */
+    while(pos < pat.size()) {
+        if(pat[pos] == ':' || pat[pos] == '*') {
+            bool isParam = pat[pos] == ':';
+            size_t end = isParam ? pat.find('/', pos) : pat.size();
+            if(end == string::npos) { end = pat.size(); }
+            string name = pat.substr(pos + 1, end - pos - 1);
+            int child = isParam ? nodes_[n].paramChild : nodes_[n].wildChild;
+            if(child < 0) {
+                child = NewNode_("");
+                if(isParam) {
+                    nodes_[n].paramChild = child;
+                    nodes_[n].paramName = name;
+                } else {
+                    nodes_[n].wildChild = child;
+                    nodes_[n].wildName = name;
+                }
+            }
+            else if((isParam ? nodes_[n].paramName : nodes_[n].wildName) != name) {
+                LOG_WARN("Route %s: parameter '%s' shares its position with '%s'", pat.c_str(), name.c_str(),
+                            (isParam ? nodes_[n].paramName : nodes_[n].wildName).c_str());
+            }
+            n = child;
+            pos = end;
+            continue;
+        }
+
+        /* 静态段: 到下一个参数或通配符为止 */
+        size_t end = pat.find_first_of(":*", pos);
+        if(end == string::npos) { end = pat.size(); }
+        size_t idx = nodes_[n].firstBytes.find(pat[pos]);
+        if(idx == string::npos) {
+            int child = NewNode_(pat.substr(pos, end - pos));
+            nodes_[n].firstBytes.push_back(pat[pos]);
+            nodes_[n].children.push_back(child);
+            n = child;
+            pos = end;
+            continue;
+        }
+        int child = nodes_[n].children[idx];
+        const string& prefix = nodes_[child].prefix;
+        size_t common = 0;
+        while(common < prefix.size() && pos + common < end && prefix[common] == pat[pos + common]) {
+            common++;
+        }
+        if(common < prefix.size()) {
+            /* 公共前缀短于子节点前缀: 拆出一个中间节点 */
+            int mid = NewNode_(prefix.substr(0, common));
+            nodes_[child].prefix = nodes_[child].prefix.substr(common);
+            nodes_[mid].firstBytes.push_back(nodes_[child].prefix[0]);
+            nodes_[mid].children.push_back(child);
+            nodes_[n].children[idx] = mid;
+            child = mid;
+        }
+        n = child;
+        pos += common;
+    }
+
+    for(auto& item: nodes_[n].handlers) {
+        if(item.first == route.method) {
+            LOG_WARN("Route %s %s registered twice, the later one wins", route.method.c_str(), pat.c_str());
+            item.second = route.handler;
+            return;
+        }
+    }
+    nodes_[n].handlers.emplace_back(route.method, route.handler);
+}
+
+/* 进入节点 n 时其前缀已匹配，pos 为剩余部分的起点；失败时回溯尝试优先级更低的分支 */
+int Router::Match_(int n, const string& path, size_t pos, RouteParams* params) const {
+    const Node& node = nodes_[n];
+    if(pos == path.size()) {
+        if(!node.handlers.empty()) { return n; }
+    }
+    else {
+        size_t idx = node.firstBytes.find(path[pos]);
+        if(idx != string::npos) {
+            int child = node.children[idx];
+            const string& prefix = nodes_[child].prefix;
+            if(path.compare(pos, prefix.size(), prefix) == 0) {
+                int ret = Match_(child, path, pos + prefix.size(), params);
+                if(ret >= 0) { return ret; }
+            }
+        }
+        if(node.paramChild >= 0) {
+            size_t end = path.find('/', pos);
+            if(end == string::npos) { end = path.size(); }
+            if(end > pos) {
+                params->Push(&node.paramName, path.data() + pos, end - pos);
+                int ret = Match_(node.paramChild, path, end, params);
+                if(ret >= 0) { return ret; }
+                params->Pop();
+            }
+        }
+    }
+    if(node.wildChild >= 0 && !nodes_[node.wildChild].handlers.empty()) {
+        params->Push(&node.wildName, path.data() + pos, path.size() - pos);
+        return node.wildChild;
+    }
+    return -1;
+}
+
+void Router::Dispatch(HttpRequest& request, RouteParams* params, HttpReply* reply) const {
+    assert(compiled_);
+    params->Clear();
+    reply->Clear();
+    reply->head = request.method() == "HEAD";
+    int n = Match_(0, request.path(), 0, params);
+    if(n < 0) {
+        reply->Error(404);
+        return;
+    }
+    HttpHandler* handler = nullptr;
+    for(auto& item: nodes_[n].handlers) {
+        if(item.first == request.method()) {
+            handler = item.second.get();
+            break;
+        }
+        /* 未单独注册 HEAD 时交给 GET 处理 */
+        if(item.first == "GET" && request.method() == "HEAD") {
+            handler = item.second.get();
+        }
+    }
+    if(!handler) {
+        reply->Error(405);
+        bool hasGet = false, hasHead = false;
+        for(auto& item: nodes_[n].handlers) {
+            if(!reply->allow.empty()) { reply->allow += ", "; }
+            reply->allow += item.first;
+            hasGet = hasGet || item.first == "GET";
+            hasHead = hasHead || item.first == "HEAD";
+        }
+        if(hasGet && !hasHead) { reply->allow += ", HEAD"; }
+        return;
+    }
+    handler->Handle(request, *params, reply);
+}
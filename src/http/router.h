@@ -0,0 +1,136 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <utility>
+#include <assert.h>
+
+#include "../log/log.h"
+#include "httprequest.h"
+#include "httpresponse.h"
+
+/* 路径参数: ":name" 匹配一段，"*name" 匹配剩余全部 */
+class RouteParams {
+public:
+    void Clear() { params_.clear(); }
+    void Push(const std::string* name, const char* value, size_t len) {
+        params_.emplace_back(name, std::string(value, len));
+    }
+    void Pop() { params_.pop_back(); }
+
+    /* 不存在时返回空串 */
+    const std::string& Get(const std::string& name) const;
+
+private:
+    std::vector<std::pair<const std::string*, std::string>> params_;
+};
+
+/* 处理器的输出，三选一: 资源文件、内联正文、流式正文 */
+struct HttpReply {
+    enum KIND {
+        FILE,       // srcDir 下的资源，code >= 400 时用对应的错误页
+        CONTENT,    // 处理器生成的完整正文
+        STREAM,     // 边生成边发送
+    };
+
+    void Clear() {
+        kind = FILE;
+        code = 200;
+        path.clear();
+        contentType.clear();
+        content.clear();
+        producer = nullptr;
+        head = false;
+        allow.clear();
+    }
+    void File(const std::string& filePath, int status = 200) {
+        kind = FILE;
+        code = status;
+        path = filePath;
+    }
+    void Error(int status) { File("", status); }
+    void Content(const std::string& type, std::string body, int status = 200) {
+        kind = CONTENT;
+        code = status;
+        contentType = type;
+        content = std::move(body);
+    }
+    void Stream(const std::string& type, HttpResponse::BodyProducer bodyProducer) {
+        kind = STREAM;
+        code = 200;
+        contentType = type;
+        producer = std::move(bodyProducer);
+    }
+
+    KIND kind;
+    int code;
+    std::string path;
+    std::string contentType;
+    std::string content;
+    HttpResponse::BodyProducer producer;
+    bool head;      // HEAD 请求: 只发头部，由 HttpConn 丢弃正文
+    std::string allow;  // 405 时该路径支持的方法，写进 Allow 头
+};
+
+/* 处理器会被多个工作线程/反应堆同时调用，需自行保证线程安全 */
+class HttpHandler {
+public:
+    virtual ~HttpHandler() = default;
+    virtual void Handle(HttpRequest& request, const RouteParams& params, HttpReply* reply) = 0;
+};
+
+/* method + path -> 处理器
+ * 启动前注册路由，Compile() 一次性构建成压缩前缀树(radix trie)，之后只读，一次查找完成分发。
+ * 同一位置上静态段优先于 ":param"，":param" 优先于 "*wildcard"。 */
+class Router {
+public:
+    typedef std::function<void(HttpRequest&, const RouteParams&, HttpReply*)> HandlerFunc;
+
+    static Router* Instance();
+
+    void Add(const std::string& method, const std::string& pattern, std::shared_ptr<HttpHandler> handler);
+    void Add(const std::string& method, const std::string& pattern, HandlerFunc func);
+
+    void Compile();
+
+    /* 未匹配到路径回复 404，路径存在但方法不支持回复 405(附 Allow)，HEAD 默认走 GET 的处理器 */
+    void Dispatch(HttpRequest& request, RouteParams* params, HttpReply* reply) const;
+
+    size_t RouteCount() const { return routes_.size(); }
+
+private:
+    Router(): compiled_(false) {}
+
+    struct Route {
+        std::string method;
+        std::string pattern;
+        std::shared_ptr<HttpHandler> handler;
+    };
+
+    /* 节点存放在连续数组中，子节点用下标引用 */
+    struct Node {
+        std::string prefix;           // 压缩后的静态前缀，参数/通配节点为空
+        std::string firstBytes;       // 各静态子节点前缀的首字节，与 children 一一对应
+        std::vector<int> children;
+        int paramChild;
+        int wildChild;
+        std::string paramName;
+        std::string wildName;
+        std::vector<std::pair<std::string, std::shared_ptr<HttpHandler>>> handlers;
+
+        Node(): paramChild(-1), wildChild(-1) {}
+    };
+
+    int NewNode_(const std::string& prefix);
+    void Insert_(const Route& route);
+    int Match_(int n, const std::string& path, size_t pos, RouteParams* params) const;
+
+    bool compiled_;
+    std::vector<Route> routes_;
+    std::vector<Node> nodes_;
+};
+
+#endif //ROUTER_H
@@ -0,0 +1,214 @@
+#include "accesslog.h"
+#include "log.h"
+
+using namespace std;
+
+/* Request 里 min(path.size(), MAX_PATH_LEN) 按引用取参 */
+const size_t AccessLog::MAX_PATH_LEN;
+
+namespace {
+void FillRecord(AccessRecord* rec, AccessRecord::TYPE type, int fd, const sockaddr_in& addr) {
+    memset(rec, 0, sizeof(*rec));
+    rec->type = type;
+    rec->fd = fd;
+    rec->timeUs = AccessLog::NowUs();
+    rec->peerIp = addr.sin_addr.s_addr;
+    rec->peerPort = ntohs(addr.sin_port);
+}
+
+uint8_t MethodCode(const string& method) {
+    static const char* METHODS[] = { "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS", "PATCH" };
+    for(size_t i = 0; i < sizeof(METHODS) / sizeof(METHODS[0]); i++) {
+        if(method == METHODS[i]) { return static_cast<uint8_t>(AccessRecord::GET + i); }
+    }
+    return AccessRecord::OTHER;
+}
+}
+
+AccessLog::AccessLog() {
+    isOpen_ = false;
+    segmentRecords_ = 0;
+    fd_ = -1;
+    base_ = nullptr;
+    used_ = 0;
+    segment_ = 0;
+    retryUs_ = 0;
+    dropped_ = 0;
+}
+
+AccessLog::~AccessLog() {
+    lock_guard<mutex> locker(mtx_);
+    CloseSegment_();
+}
+
+AccessLog* AccessLog::Instance() {
+    static AccessLog inst;
+    return &inst;
+}
+
+void AccessLog::Init(const char* path, int segmentMB) {
+    if(isOpen_ || segmentMB <= 0) { return; }
+    path_ = path;
+    segmentRecords_ = static_cast<size_t>(segmentMB) * 1024 * 1024 / ACCESS_RECORD_SIZE;
+    lock_guard<mutex> locker(mtx_);
+    isOpen_ = OpenSegment_();
+}
+
+bool AccessLog::OpenSegment_() {
+    assert(base_ == nullptr);
+    time_t timer = time(nullptr);
+    struct tm t;
+    localtime_r(&timer, &t);
+    char fileName[256];
+    snprintf(fileName, sizeof(fileName), "%s/access_%04d%02d%02d_%02d%02d%02d_%04d.bin",
+            path_.c_str(), t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+            t.tm_hour, t.tm_min, t.tm_sec, segment_ + 1);
+
+    fd_ = open(fileName, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd_ < 0) {
+        mkdir(path_.c_str(), 0777);
+        fd_ = open(fileName, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if(fd_ < 0) {
+        LOG_ERROR("AccessLog: open %s failed, errno %d", fileName, errno);
+        return false;
+    }
+    size_t bytes = segmentRecords_ * ACCESS_RECORD_SIZE;
+    /* 先把磁盘空间真正分配下来: ftruncate 出的稀疏文件在磁盘写满时，写映射会收到 SIGBUS */
+    int err = posix_fallocate(fd_, 0, bytes);
+    if(err != 0) {
+        LOG_ERROR("AccessLog: reserve %zu bytes for %s failed, errno %d", bytes, fileName, err);
+        close(fd_);
+        fd_ = -1;
+        unlink(fileName);
+        return false;
+    }
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(base == MAP_FAILED) {
+        LOG_ERROR("AccessLog: map %s failed, errno %d", fileName, errno);
+        close(fd_);
+        fd_ = -1;
+        unlink(fileName);
+        return false;
+    }
+    base_ = static_cast<AccessRecord*>(base);
+    segment_++;
+
+    AccessFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic));
+    header.version = ACCESS_LOG_VERSION;
+    header.recordSize = ACCESS_RECORD_SIZE;
+    header.segment = segment_;
+    header.startUs = NowUs();
+    memcpy(base_, &header, sizeof(header));
+    used_ = 1;
+    return true;
+}
+
+void AccessLog::CloseSegment_() {
+    if(!base_) { return; }
+    munmap(base_, segmentRecords_ * ACCESS_RECORD_SIZE);
+    /* 去掉没用到的尾部 */
+    if(ftruncate(fd_, used_ * ACCESS_RECORD_SIZE) != 0) {
+        LOG_WARN("AccessLog: truncate segment %d failed, errno %d", segment_, errno);
+    }
+    close(fd_);
+    fd_ = -1;
+    base_ = nullptr;
+    used_ = 0;
+}
+
+/* 当前分段放不下 count 条时换新分段。
+ * 打不开新分段(如磁盘满)时丢弃这次的记录，RETRY_US 内不再重试，恢复后报告丢了多少条 */
+AccessRecord* AccessLog::Claim_(size_t count) {
+    if(base_ && used_ + count <= segmentRecords_) {
+        AccessRecord* rec = base_ + used_;
+        used_ += count;
+        return rec;
+    }
+    CloseSegment_();
+    int64_t now = NowUs();
+    if(now < retryUs_ || !OpenSegment_()) {
+        if(now >= retryUs_) { retryUs_ = now + RETRY_US; }
+        dropped_++;
+        return nullptr;
+    }
+    if(dropped_ > 0) {
+        LOG_WARN("AccessLog: %zu records dropped while no segment could be opened", dropped_);
+        dropped_ = 0;
+    }
+    assert(used_ + count <= segmentRecords_);
+    AccessRecord* rec = base_ + used_;
+    used_ += count;
+    return rec;
+}
+
+AccessLog::PathEntry* AccessLog::FindPath_(const string& path) {
+    /* 只有超长路径才需要截断后再查 */
+    auto it = path.size() > MAX_PATH_LEN ? paths_.find(path.substr(0, MAX_PATH_LEN)) : paths_.find(path);
+    if(it == paths_.end()) {
+        if(paths_.size() >= MAX_PATHS) { return nullptr; }
+        PathEntry entry = { static_cast<uint32_t>(paths_.size() + 1), 0 };
+        it = paths_.emplace(path.substr(0, MAX_PATH_LEN), entry).first;
+    }
+    return &it->second;
+}
+
+void AccessLog::Connect(int fd, const sockaddr_in& addr, int users) {
+    if(!isOpen_) { return; }
+    AccessRecord rec;
+    FillRecord(&rec, AccessRecord::CONNECT, fd, addr);
+    rec.users = users;
+    lock_guard<mutex> locker(mtx_);
+    AccessRecord* slot = Claim_(1);
+    if(slot) { memcpy(slot, &rec, sizeof(rec)); }
+}
+
+void AccessLog::Close(int fd, const sockaddr_in& addr, int users) {
+    if(!isOpen_) { return; }
+    AccessRecord rec;
+    FillRecord(&rec, AccessRecord::CLOSE, fd, addr);
+    rec.users = users;
+    lock_guard<mutex> locker(mtx_);
+    AccessRecord* slot = Claim_(1);
+    if(slot) { memcpy(slot, &rec, sizeof(rec)); }
+}
+
+void AccessLog::Request(int fd, const sockaddr_in& addr, const string& method, const string& path,
+                        int status, size_t bytes, int64_t latencyUs) {
+    if(!isOpen_) { return; }
+    AccessRecord rec;
+    FillRecord(&rec, AccessRecord::REQUEST, fd, addr);
+    rec.method = MethodCode(method);
+    rec.status = static_cast<uint16_t>(status);
+    rec.bytes = bytes;
+    rec.latencyUs = static_cast<uint32_t>(latencyUs > 0 ? latencyUs : 0);
+
+    size_t len = min(path.size(), MAX_PATH_LEN);
+    size_t blocks = (len + ACCESS_RECORD_SIZE - 1) / ACCESS_RECORD_SIZE;
+    lock_guard<mutex> locker(mtx_);
+    PathEntry* entry = FindPath_(path);
+    rec.pathId = entry ? entry->id : 0;
+    /* 定义和引用必须落在同一分段: 按需要写定义来预留，用不到的退回 */
+    AccessRecord* slot = Claim_(entry ? 2 + blocks : 1);
+    if(!slot) { return; }
+    if(entry) {
+        if(entry->segment != segment_) {
+            AccessRecord def;
+            memset(&def, 0, sizeof(def));
+            def.type = AccessRecord::PATH;
+            def.timeUs = rec.timeUs;
+            def.pathId = rec.pathId;
+            def.pathLen = static_cast<uint16_t>(len);
+            memcpy(slot++, &def, sizeof(def));
+            memcpy(slot, path.data(), len);
+            memset(reinterpret_cast<char*>(slot) + len, 0, blocks * ACCESS_RECORD_SIZE - len);
+            slot += blocks;
+            entry->segment = segment_;
+        } else {
+            used_ -= 1 + blocks;
+        }
+    }
+    memcpy(slot, &rec, sizeof(rec));
+}
@@ -0,0 +1,77 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>             // clock_gettime
+#include <fcntl.h>            // open posix_fallocate
+#include <unistd.h>           // ftruncate close unlink
+#include <sys/mman.h>         // mmap munmap
+#include <sys/stat.h>         // mkdir
+#include <netinet/in.h>       // sockaddr_in
+
+#include "accessrecord.h"
+
+/* 二进制访问日志: 每个连接/请求一条 64 字节记录，不做文本格式化。
+ * 记录直接拷进 mmap 的分段文件，写满一个分段换下一个，落盘交给内核。
+ * 用 tools/decodeAccessLog 转成文本或 CSV。 */
+class AccessLog {
+public:
+    static AccessLog* Instance();
+
+    /* segmentMB 为 0 时关闭；只在启动时调用一次。
+     * 第一个分段建不起来(目录不可写、磁盘空间不足)时保持关闭，连接进出仍写文本日志 */
+    void Init(const char* path, int segmentMB);
+    bool IsOpen() const { return isOpen_; }
+
+    void Connect(int fd, const sockaddr_in& addr, int users);
+    void Close(int fd, const sockaddr_in& addr, int users);
+    void Request(int fd, const sockaddr_in& addr, const std::string& method, const std::string& path,
+                 int status, size_t bytes, int64_t latencyUs);
+
+    static int64_t NowUs() {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+    }
+
+private:
+    AccessLog();
+    ~AccessLog();
+
+    struct PathEntry {
+        uint32_t id;
+        int segment;    // 最近一次写出定义的分段
+    };
+
+    /* 以下调用者持有 mtx_ */
+    AccessRecord* Claim_(size_t count);
+    /* 路径表满时返回 nullptr */
+    PathEntry* FindPath_(const std::string& path);
+    bool OpenSegment_();
+    void CloseSegment_();
+
+    static const size_t MAX_PATHS = 4096;      // 路径表满了之后新路径都记为 id 0
+    static const size_t MAX_PATH_LEN = 512;    // 更长的路径截断
+    static const int64_t RETRY_US = 1000000;   // 打开分段失败后的重试间隔
+
+    bool isOpen_;
+    std::string path_;
+    size_t segmentRecords_;
+
+    std::mutex mtx_;
+    int fd_;
+    AccessRecord* base_;
+    size_t used_;       // 当前分段已用的记录数，含文件头
+    int segment_;
+    int64_t retryUs_;   // 此前不再尝试打开新分段
+    size_t dropped_;    // 没有可用分段时丢弃的记录数
+    std::unordered_map<std::string, PathEntry> paths_;
+};
+
+#endif //ACCESS_LOG_H
@@ -0,0 +1,56 @@
+#ifndef ACCESS_RECORD_H
+#define ACCESS_RECORD_H
+
+#include <stdint.h>
+
+/* 二进制访问日志的文件格式，写入端 AccessLog 与 tools/decodeAccessLog 共用。
+ * 一个分段文件 = 文件头 + 若干 64 字节定长记录，字段按本机字节序存放。
+ * 路径用 id 表示，id 第一次在某个分段中出现前先写一条 PATH 记录，
+ * 其后紧跟 (pathLen + 63) / 64 个 64 字节块存放路径原文，因此每个分段可以单独解码。
+ * 进程异常退出时分段尾部是全 0 的记录(type 为 0)，解码到这里结束。 */
+
+static const char ACCESS_LOG_MAGIC[8] = { 'W', 'S', 'A', 'C', 'C', 'L', 'O', 'G' };
+static const uint16_t ACCESS_LOG_VERSION = 1;
+static const uint32_t ACCESS_RECORD_SIZE = 64;
+
+struct AccessFileHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t segment;       // 本次运行中的分段序号
+    int64_t startUs;        // 分段创建时间，微秒
+    char pad[40];
+};
+
+struct AccessRecord {
+    enum TYPE {
+        END = 0,            // 未写入的空间
+        PATH,               // 路径定义
+        CONNECT,            // 新连接，替代 "Client in" 文本日志
+        REQUEST,            // 一个请求的响应已排队
+        CLOSE,              // 连接关闭，替代 "Client quit" 文本日志
+    };
+
+    enum METHOD {
+        OTHER = 0, GET, HEAD, POST, PUT, DELETE, OPTIONS, PATCH,
+    };
+
+    uint8_t type;
+    uint8_t method;         // METHOD
+    uint16_t status;
+    int32_t fd;
+    int64_t timeUs;         // 墙上时间，微秒
+    uint32_t peerIp;        // 网络字节序
+    uint16_t peerPort;      // 主机字节序
+    uint16_t pathLen;       // 只用于 PATH
+    uint32_t pathId;        // 0 表示路径表已满或未知
+    uint32_t latencyUs;     // 最后一次读到数据 -> 响应排队
+    uint64_t bytes;         // 响应字节数(头 + 体)，流式响应只计头部
+    uint32_t users;         // CONNECT/CLOSE 时的在线连接数
+    char pad[20];
+};
+
+static_assert(sizeof(AccessFileHeader) == ACCESS_RECORD_SIZE, "access log header must be one record");
+static_assert(sizeof(AccessRecord) == ACCESS_RECORD_SIZE, "access log record must be 64 bytes");
+
+#endif //ACCESS_RECORD_H
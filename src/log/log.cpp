@@ -2,179 +2,481 @@
 
 using namespace std;
 
+/* 作为 chrono::milliseconds 的构造参数被 ODR 使用，要有类外定义 */
+const int Log::FLUSH_INTERVAL_MS;
+
 Log::Log() {
     lineCount_ = 0; 
+    part_ = 0;
     isAsync_ = false;  
+    engine_ = RING;
     writeThread_ = nullptr;  // 后台写日志线程
-    deque_ = nullptr;  // 阻塞队列
-    toDay_ = 0;  // 记录当前时间是哪一天
-    fp_ = nullptr;  // 打开log的文件指针
+    ring_ = nullptr;  // 无锁环形队列
+    toDay_ = 0;  // 记录当前文件是哪一天
+    fd_ = -1;  // 打开的 log 文件
+    batchLen_ = 0;
+    sleeping_ = false;
+    isClosing_ = false;
 }
 
 Log::~Log() {
     if(writeThread_ && writeThread_->joinable()) {
-        while(!deque_->empty()) {
-            deque_->flush();
-        };
-        deque_->Close();
+        /* 写线程取空队列后退出 */
+        isClosing_ = true;
+        cond_.notify_one();
         writeThread_->join();
     }
-    if(fp_) {
-        lock_guard<mutex> locker(mtx_);
-        flush();
-        fclose(fp_);
+    if(fd_ >= 0) {
+        close(fd_);
     }
 }
 
-int Log::GetLevel() {
-    lock_guard<mutex> locker(mtx_);
-    return level_;
-}
-
-void Log::SetLevel(int level) {
-    lock_guard<mutex> locker(mtx_);
-    level_ = level;
-}
-
 void Log::init(int level = 1, const char* path, const char* suffix,
-    int maxQueueSize) {
+    int maxQueueSize, int engine) {
     isOpen_ = true;
     level_ = level;
-    if(maxQueueSize > 0) {
-        isAsync_ = true;  // 启用异步日志
-        if(!deque_) {
-            unique_ptr<BlockDeque<std::string>> newDeque(new BlockDeque<std::string>);
-            deque_ = move(newDeque);
-            
-            std::unique_ptr<std::thread> NewThread(new thread(FlushLogThread));
-            writeThread_ = move(NewThread);
-        }
-    } else {
-        isAsync_ = false;
-    }
-
     lineCount_ = 0;
+    part_ = 0;
 
     time_t timer = time(nullptr);
-    struct tm *sysTime = localtime(&timer);  //  获取当前时间
-    struct tm t = *sysTime;
+    struct tm t;
+    localtime_r(&timer, &t);  //  获取当前时间
     path_ = path;
     suffix_ = suffix;
     char fileName[LOG_NAME_LEN] = {0};
     snprintf(fileName, LOG_NAME_LEN - 1, "%s/%04d_%02d_%02d%s", 
             path_, t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix_);
-    toDay_ = t.tm_mday;
+    toDay_ = (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
 
     {
         lock_guard<mutex> locker(mtx_);
-        buff_.RetrieveAll();
-        if(fp_) { 
-            flush();
-            fclose(fp_); 
-        }
+        OpenFile_(fileName);
+    }
 
-        fp_ = fopen(fileName, "a");
-        if(fp_ == nullptr) {
-            mkdir(path_, 0777);
-            fp_ = fopen(fileName, "a");
-        } 
-        assert(fp_ != nullptr);
+    if(maxQueueSize > 0) {
+        isAsync_ = true;  // 启用异步日志
+        /* 写线程只起一次，引擎以第一次为准 */
+        if(!writeThread_) {
+            engine_ = engine;
+            if(engine_ == RING) {
+                ring_.reset(new LogRing(maxQueueSize));
+                batch_.resize(BATCH_SIZE);
+            }
+            writeThread_.reset(new thread(FlushLogThread));
+        }
+    } else {
+        isAsync_ = false;
     }
 }
 
-void Log::write(int level, const char *format, ...) {
-    struct timeval now = {0, 0};  
-    gettimeofday(&now, nullptr);  
-    time_t tSec = now.tv_sec;
-    struct tm *sysTime = localtime(&tSec);
-    struct tm t = *sysTime;
-    va_list vaList;
+void Log::OpenFile_(const char* fileName) {
+    if(fd_ >= 0) { close(fd_); }
+    fd_ = open(fileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(fd_ < 0) {
+        mkdir(path_, 0777);
+        fd_ = open(fileName, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+    assert(fd_ >= 0);
+}
 
+void Log::CheckRotate_(int32_t date) {
     /* 日志日期 日志行数 */
-    if (toDay_ != t.tm_mday || (lineCount_ && (lineCount_  %  MAX_LINES == 0))) 
-    {
-        unique_lock<mutex> locker(mtx_);
-        locker.unlock();
-        
-        char newFile[LOG_NAME_LEN];
-        char tail[36] = {0};
-        snprintf(tail, 36, "%04d_%02d_%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    if(!NeedRotate_(date)) {
+        return;
+    }
+    char newFile[LOG_NAME_LEN];
+    char tail[36] = {0};
+    snprintf(tail, 36, "%04d_%02d_%02d", date / 10000, date / 100 % 100, date % 100);
 
-        if (toDay_ != t.tm_mday)
-        {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
-            toDay_ = t.tm_mday;
-            lineCount_ = 0;
+    if(toDay_ != date) {
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s%s", path_, tail, suffix_);
+        toDay_ = date;
+        part_ = 0;
+    }
+    else {
+        snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, ++part_, suffix_);
+    }
+    lineCount_ = 0;
+    OpenFile_(newFile);
+}
+
+void Log::WriteFd_(const char* data, size_t len) {
+    while(len > 0) {
+        ssize_t n = ::write(fd_, data, len);
+        if(n < 0) {
+            if(errno == EINTR) { continue; }
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+namespace {
+/* 每个线程缓存当前这一秒的 "YYYY-MM-DD HH:MM:SS."，同一秒内只重写微秒 */
+struct TimePrefix {
+    static const int LEN = 20;
+
+    TimePrefix(): sec(-1), date(0) {}
+
+    time_t sec;
+    int32_t date;   // yyyymmdd，跨天时随前缀一起更新
+    char text[LEN];
+};
+
+/* 写 width 位十进制，不足补 0 */
+void PutDigits(char* p, long value, int width) {
+    for(int i = width - 1; i >= 0; i--) {
+        p[i] = '0' + value % 10;
+        value /= 10;
+    }
+}
+
+thread_local TimePrefix tlsTime;
+
+/* 无符号整数转十进制，返回位数 */
+int PutUnsigned(char* p, unsigned long long value) {
+    char tmp[20];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + value % 10;
+        value /= 10;
+    } while(value);
+    for(int i = 0; i < n; i++) {
+        p[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+/* 日志里只用到 %d %s %zu 这类不带宽度精度的转换，直接展开，省掉 vsnprintf 的通用解析。
+ * 最多写 cap 字节，超出截断；遇到其他写法(宽度、精度、浮点等)返回 -1，由调用方改用 vsnprintf */
+int FormatArgs(char* buf, size_t cap, const char* format, va_list vaList) {
+    size_t n = 0;
+    char num[24];
+    for(const char* f = format; *f; f++) {
+        const char* src = f;
+        size_t len = 1;
+        if(*f != '%') {
+            /* 普通字符整段拷贝 */
+            while(f[1] && f[1] != '%') { f++; }
+            len = f - src + 1;
         }
         else {
-            snprintf(newFile, LOG_NAME_LEN - 72, "%s/%s-%d%s", path_, tail, (lineCount_  / MAX_LINES), suffix_);
+            f++;
+            int lng = 0;
+            if(*f == 'z') { lng = 2; f++; }
+            else if(*f == 'l') {
+                lng = 1; f++;
+                if(*f == 'l') { lng = 2; f++; }
+            }
+            switch(*f) {
+            case 'd': case 'i': {
+                long long v = lng == 0 ? va_arg(vaList, int) :
+                              lng == 1 ? va_arg(vaList, long) : va_arg(vaList, long long);
+                unsigned long long u = v < 0 ? 0ull - v : v;
+                len = 0;
+                if(v < 0) { num[len++] = '-'; }
+                len += PutUnsigned(num + len, u);
+                src = num;
+                break;
+            }
+            case 'u': {
+                unsigned long long u = lng == 0 ? va_arg(vaList, unsigned) :
+                                       lng == 1 ? va_arg(vaList, unsigned long) : va_arg(vaList, unsigned long long);
+                len = PutUnsigned(num, u);
+                src = num;
+                break;
+            }
+            case 's':
+                if(lng) { return -1; }
+                src = va_arg(vaList, const char*);
+                if(!src) { src = "(null)"; }
+                len = strlen(src);
+                break;
+            case 'c':
+                if(lng) { return -1; }
+                num[0] = static_cast<char>(va_arg(vaList, int));
+                src = num;
+                break;
+            case '%':
+                if(lng) { return -1; }
+                src = f;
+                break;
+            default:
+                return -1;
+            }
         }
-        
-        locker.lock();
-        flush();
-        fclose(fp_);
-        fp_ = fopen(newFile, "a");
-        assert(fp_ != nullptr);
+        if(len > cap - n) {
+            memcpy(buf + n, src, cap - n);
+            return cap;
+        }
+        memcpy(buf + n, src, len);
+        n += len;
     }
+    return n;
+}
+}
 
-    {
-        unique_lock<mutex> locker(mtx_);
+int Log::FormatLine_(char* buf, size_t size, int level, const char* format, va_list vaList, int32_t* date) {
+    /* CLOCK_REALTIME 走 vDSO，不进内核 */
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    TimePrefix& prefix = tlsTime;
+    if(now.tv_sec != prefix.sec) {
+        /* 每个线程每秒一次 localtime_r */
+        struct tm t;
+        localtime_r(&now.tv_sec, &t);
+        char* p = prefix.text;
+        memcpy(p, "0000-00-00 00:00:00.", TimePrefix::LEN);
+        PutDigits(p, t.tm_year + 1900, 4);
+        PutDigits(p + 5, t.tm_mon + 1, 2);
+        PutDigits(p + 8, t.tm_mday, 2);
+        PutDigits(p + 11, t.tm_hour, 2);
+        PutDigits(p + 14, t.tm_min, 2);
+        PutDigits(p + 17, t.tm_sec, 2);
+        prefix.date = (t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+        prefix.sec = now.tv_sec;
+    }
+    *date = prefix.date;
+
+    memcpy(buf, prefix.text, TimePrefix::LEN);
+    int n = TimePrefix::LEN;
+    PutDigits(buf + n, now.tv_nsec / 1000, 6);
+    n += 6;
+    buf[n++] = ' ';
+    memcpy(buf + n, LevelTitle_(level), 9);
+    n += 9;
+
+    /* 留一个字节给换行 */
+    size_t avail = size - n;
+    va_list copy;
+    va_copy(copy, vaList);
+    int m = FormatArgs(buf + n, avail - 2, format, copy);
+    va_end(copy);
+    if(m < 0) {
+        m = vsnprintf(buf + n, avail - 1, format, vaList);
+    }
+    if(m > 0) {
+        n += min(static_cast<size_t>(m), avail - 2);
+    }
+    buf[n++] = '\n';
+    return n;
+}
+
+void Log::write(int level, const char *format, ...) {
+    va_list vaList;
+    va_start(vaList, format);
+    if(!isAsync_) {
+        char line[LogRecord::DATA_SIZE];
+        int32_t date;
+        int n = FormatLine_(line, sizeof(line), level, format, vaList, &date);
+
+        lock_guard<mutex> locker(mtx_);
+        CheckRotate_(date);
         lineCount_++;
-        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
-                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
-                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
-                    
-        buff_.HasWritten(n);
-        AppendLogLevelTitle_(level);
-
-        va_start(vaList, format);
-        int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
-        va_end(vaList);
-
-        buff_.HasWritten(m);
-        buff_.Append("\n\0", 2);
-
-        if(isAsync_ && deque_ && !deque_->full()) {
-            deque_->push_back(buff_.RetrieveAllToStr());
-        } else {
-            fputs(buff_.Peek(), fp_);
+        WriteFd_(line, n);
+    }
+    else if(engine_ == THREAD_BUFFER) {
+        WriteToBuffer_(level, format, vaList);
+    }
+    else {
+        WriteToRing_(level, format, vaList);
+    }
+    va_end(vaList);
+}
+
+void Log::WriteToRing_(int level, const char* format, va_list vaList) {
+    /* 队列满时唤醒写线程并让出 CPU，不丢日志 */
+    LogRecord* rec = ring_->Claim();
+    while(!rec) {
+        flush();
+        this_thread::yield();
+        rec = ring_->Claim();
+    }
+    rec->len = FormatLine_(rec->data, sizeof(rec->data), level, format, vaList, &rec->date);
+    ring_->Publish(rec);
+
+    /* 平时不唤醒，写线程定时醒来批量写 */
+    if(sleeping_.load(memory_order_relaxed) && ring_->Size() >= ring_->Capacity() / 2) {
+        flush();
+    }
+}
+
+ThreadLogBuffer* Log::LocalBuffer_() {
+    /* 线程退出时只做标记，剩下的内容由写线程取走后再注销 */
+    struct Holder {
+        std::shared_ptr<ThreadLogBuffer> buf;
+        ~Holder() {
+            if(buf) {
+                lock_guard<mutex> locker(buf->mtx);
+                buf->exited = true;
+            }
+        }
+    };
+    static thread_local Holder holder;
+    if(!holder.buf) {
+        holder.buf = make_shared<ThreadLogBuffer>();
+        lock_guard<mutex> locker(bufferMtx_);
+        buffers_.push_back(holder.buf);
+    }
+    return holder.buf.get();
+}
+
+void Log::WriteToBuffer_(int level, const char* format, va_list vaList) {
+    ThreadLogBuffer* tb = LocalBuffer_();
+    unique_lock<mutex> locker(tb->mtx);
+    /* 写线程跟不上时等它取走，不丢日志 */
+    while(tb->full.size() >= MAX_PENDING_CHUNKS) {
+        locker.unlock();
+        flush();
+        this_thread::yield();
+        locker.lock();
+    }
+
+    bool wake = false;
+    if(!tb->current || tb->current->Avail() < LogRecord::DATA_SIZE) {
+        if(tb->current) {
+            tb->full.push_back(std::move(tb->current));
+            wake = true;
         }
-        buff_.RetrieveAll();
+        tb->current = tb->spare ? std::move(tb->spare) : unique_ptr<LogChunk>(new LogChunk);
+    }
+
+    LogChunk* chunk = tb->current.get();
+    int32_t date;
+    int n = FormatLine_(chunk->data + chunk->len, LogRecord::DATA_SIZE, level, format, vaList, &date);
+    if(chunk->lines > 0 && chunk->date != date) {
+        /* 跨天: 这一行挪到新块，保证一块只属于一天 */
+        unique_ptr<LogChunk> next(tb->spare ? std::move(tb->spare) : unique_ptr<LogChunk>(new LogChunk));
+        memcpy(next->data, chunk->data + chunk->len, n);
+        tb->full.push_back(std::move(tb->current));
+        tb->current = std::move(next);
+        chunk = tb->current.get();
+        wake = true;
     }
+    chunk->date = date;
+    chunk->len += n;
+    chunk->lines++;
+    locker.unlock();
+
+    /* 写满一块才唤醒，平时写线程定时来换 */
+    if(wake) { flush(); }
 }
 
-void Log::AppendLogLevelTitle_(int level) {
+const char* Log::LevelTitle_(int level) {
     switch(level) {
     case 0:
-        buff_.Append("[debug]: ", 9);
-        break;
+        return "[debug]: ";
     case 1:
-        buff_.Append("[info] : ", 9);
-        break;
+        return "[info] : ";
     case 2:
-        buff_.Append("[warn] : ", 9);
-        break;
+        return "[warn] : ";
     case 3:
-        buff_.Append("[error]: ", 9);
-        break;
+        return "[error]: ";
     default:
-        buff_.Append("[info] : ", 9);
-        break;
+        return "[info] : ";
     }
 }
 
 void Log::flush() {
     if(isAsync_) { 
-        deque_->flush(); 
+        cond_.notify_one();
+    }
+}
+
+void Log::FlushBatch_() {
+    if(batchLen_ > 0) {
+        WriteFd_(batch_.data(), batchLen_);
+        batchLen_ = 0;
     }
-    fflush(fp_);
 }
 
 void Log::AsyncWrite_() {
-    string str = "";
-    while(deque_->pop(str)) {
-        lock_guard<mutex> locker(mtx_);
-        fputs(str.c_str(), fp_);
+    while(true) {
+        LogRecord* rec;
+        while((rec = ring_->Peek()) != nullptr) {
+            if(NeedRotate_(rec->date)) {
+                /* 切换文件前先把攒下的写进旧文件 */
+                FlushBatch_();
+                CheckRotate_(rec->date);
+            }
+            if(batchLen_ + rec->len > batch_.size()) {
+                FlushBatch_();
+            }
+            memcpy(batch_.data() + batchLen_, rec->data, rec->len);
+            batchLen_ += rec->len;
+            lineCount_++;
+            ring_->Release(rec);
+        }
+        FlushBatch_();
+        if(isClosing_) {
+            if(!ring_->Peek()) { break; }
+            continue;
+        }
+        unique_lock<mutex> locker(mtx_);
+        sleeping_ = true;
+        cond_.wait_for(locker, chrono::milliseconds(FLUSH_INTERVAL_MS));
+        sleeping_ = false;
+    }
+}
+
+void Log::CollectBuffers_(vector<unique_ptr<LogChunk>>* toWrite,
+                          vector<unique_ptr<LogChunk>>* freeChunks) {
+    lock_guard<mutex> registry(bufferMtx_);
+    for(size_t i = 0; i < buffers_.size();) {
+        ThreadLogBuffer* tb = buffers_[i].get();
+        bool exited;
+        {
+            lock_guard<mutex> locker(tb->mtx);
+            for(auto& chunk: tb->full) {
+                toWrite->push_back(std::move(chunk));
+            }
+            tb->full.clear();
+            /* 双缓冲交换: 非空的当前块整块拿走，换上空块 */
+            if(tb->current && tb->current->len > 0) {
+                toWrite->push_back(std::move(tb->current));
+                if(!freeChunks->empty()) {
+                    tb->current = std::move(freeChunks->back());
+                    freeChunks->pop_back();
+                }
+            }
+            if(!tb->spare && !freeChunks->empty()) {
+                tb->spare = std::move(freeChunks->back());
+                freeChunks->pop_back();
+            }
+            exited = tb->exited;
+        }
+        if(exited) {
+            buffers_[i] = std::move(buffers_.back());
+            buffers_.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void Log::BufferWrite_() {
+    vector<unique_ptr<LogChunk>> toWrite;
+    vector<unique_ptr<LogChunk>> freeChunks;
+    while(true) {
+        /* 先读关闭标记再收集，最后一轮能取走关闭前写入的全部内容 */
+        bool closing = isClosing_;
+        CollectBuffers_(&toWrite, &freeChunks);
+        /* 各线程的块之间不保证时间顺序，每块一次 write */
+        for(auto& chunk: toWrite) {
+            CheckRotate_(chunk->date);
+            WriteFd_(chunk->data, chunk->len);
+            lineCount_ += chunk->lines;
+            chunk->Reset();
+            if(freeChunks.size() < MAX_FREE_CHUNKS) {
+                freeChunks.push_back(std::move(chunk));
+            }
+        }
+        toWrite.clear();
+        if(closing) { break; }
+
+        unique_lock<mutex> locker(mtx_);
+        cond_.wait_for(locker, chrono::milliseconds(FLUSH_INTERVAL_MS));
     }
 }
 
@@ -184,5 +486,10 @@ Log* Log::Instance() {
 }
 
 void Log::FlushLogThread() {
-    Log::Instance()->AsyncWrite_();
-}
\ No newline at end of file
+    Log* log = Log::Instance();
+    if(log->engine_ == THREAD_BUFFER) {
+        log->BufferWrite_();
+    } else {
+        log->AsyncWrite_();
+    }
+}
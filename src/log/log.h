@@ -2,69 +2,128 @@
 #define LOG_H
 
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <string>
+#include <vector>
 #include <thread>
 #include <sys/time.h>
+#include <time.h>             // clock_gettime localtime_r
 #include <string.h>
 #include <stdarg.h>           // vastart va_end
 #include <assert.h>
+#include <fcntl.h>            // open
+#include <unistd.h>           // write close
 #include <sys/stat.h>         //mkdir
-#include "blockqueue.h"
+#include "logring.h"
+#include "logbuffer.h"
 #include "../buffer/buffer.h"
 
 class Log {
 public:
+    /* 异步模式(maxQueueCapacity > 0)下的后端 */
+    enum ENGINE {
+        RING = 0,       // 所有线程共享一个无锁环形队列，每行一个定长槽位
+        THREAD_BUFFER,  // 每个线程一块本地缓冲，后台线程定期整块换走
+    };
+
     void init(int level, const char* path = "./log", 
                 const char* suffix =".log",
-                int maxQueueCapacity = 1024);
+                int maxQueueCapacity = 1024,
+                int engine = RING);
 
     static Log* Instance();
     static void FlushLogThread();
 
     void write(int level, const char *format,...);
+    /* 异步模式下唤醒写线程立即落盘，不等待写完 */
     void flush();
 
-    int GetLevel();
-    void SetLevel(int level);
+    /* 每条 LOG 都会读级别，不加锁 */
+    int GetLevel() const { return level_.load(std::memory_order_relaxed); }
+    void SetLevel(int level) { level_.store(level, std::memory_order_relaxed); }
     bool IsOpen() { return isOpen_; }
     
 private:
     Log();
-    void AppendLogLevelTitle_(int level);
+    static const char* LevelTitle_(int level);
     virtual ~Log();
     void AsyncWrite_();
+    void BufferWrite_();
+
+    void WriteToRing_(int level, const char* format, va_list vaList);
+    void WriteToBuffer_(int level, const char* format, va_list vaList);
+    ThreadLogBuffer* LocalBuffer_();
+    void CollectBuffers_(std::vector<std::unique_ptr<LogChunk>>* toWrite,
+                         std::vector<std::unique_ptr<LogChunk>>* freeChunks);
+
+    /* 时间戳 + 级别 + 正文 + 换行，超长截断，返回写入的字节数 */
+    int FormatLine_(char* buf, size_t size, int level, const char* format, va_list vaList, int32_t* date);
+    /* 以下只由写文件的一方调用: 异步模式的写线程，或同步模式下持有 mtx_ 的线程 */
+    bool NeedRotate_(int32_t date) const { return toDay_ != date || lineCount_ >= MAX_LINES; }
+    void CheckRotate_(int32_t date);
+    void OpenFile_(const char* fileName);
+    void WriteFd_(const char* data, size_t len);
+    void FlushBatch_();
 
 private:
     static const int LOG_PATH_LEN = 256;
     static const int LOG_NAME_LEN = 256;
     static const int MAX_LINES = 50000;
+    static const size_t BATCH_SIZE = 64 * 1024;  // 写线程攒够这么多或队列取空时 write 一次
+    static const int FLUSH_INTERVAL_MS = 50;     // 写线程空闲时的最长睡眠
+    static const size_t MAX_PENDING_CHUNKS = 8;  // 单个线程待写的块数上限，超过时等后台线程
+    static const size_t MAX_FREE_CHUNKS = 16;    // 后台线程缓存的空块数
 
     const char* path_;
     const char* suffix_;
 
     int MAX_LINES_;
 
-    int lineCount_;
-    int toDay_;
+    int lineCount_;   // 当前文件的行数
+    int part_;        // 同一天内按行数切分的序号
+    int32_t toDay_;   // 当前文件的日期 yyyymmdd
 
     bool isOpen_;  
  
-    Buffer buff_;
-    int level_;
+    std::atomic<int> level_;
     bool isAsync_;
+    int engine_;
 
-    FILE* fp_;
-    std::unique_ptr<BlockDeque<std::string>> deque_; 
+    int fd_;
+    std::unique_ptr<LogRing> ring_;
     std::unique_ptr<std::thread> writeThread_;
+    std::vector<char> batch_;
+    size_t batchLen_;
+
     std::mutex mtx_;
+    std::condition_variable cond_;
+    std::atomic<bool> sleeping_;   // 写线程在等待，队列过半时生产者才去唤醒
+    std::atomic<bool> isClosing_;
+
+    /* THREAD_BUFFER 引擎: 各线程的缓冲 */
+    std::mutex bufferMtx_;
+    std::vector<std::shared_ptr<ThreadLogBuffer>> buffers_;
 };
 
+/* 编译期最低级别: 低于它的 LOG 连同参数求值一起被编译器删掉，
+ * 运行时 SetLevel 调得再低也不会输出。build/Makefile 传 -DLOG_MIN_LEVEL=1 去掉 DEBUG，
+ * 其他构建未指定时按 NDEBUG 决定 */
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+
 #define LOG_BASE(level, format, ...) \
     do {\
-        Log* log = Log::Instance();\
-        if (log->IsOpen() && log->GetLevel() <= level) {\
-            log->write(level, format, ##__VA_ARGS__); \
-            log->flush();\
+        if (level >= LOG_MIN_LEVEL) {\
+            Log* log = Log::Instance();\
+            if (log->IsOpen() && log->GetLevel() <= level) {\
+                log->write(level, format, ##__VA_ARGS__); \
+            }\
         }\
     } while(0);
 
@@ -73,4 +132,4 @@ private:
 #define LOG_WARN(format, ...) do {LOG_BASE(2, format, ##__VA_ARGS__)} while(0);
 #define LOG_ERROR(format, ...) do {LOG_BASE(3, format, ##__VA_ARGS__)} while(0);
 
-#endif //LOG_H
\ No newline at end of file
+#endif //LOG_H
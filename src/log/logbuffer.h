@@ -0,0 +1,43 @@
+#ifndef LOG_BUFFER_H
+#define LOG_BUFFER_H
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/* 定长日志块，一块里的行都属于同一天，后台线程整块一次 write */
+struct LogChunk {
+    static const size_t SIZE = 128 * 1024;
+
+    LogChunk(): len(0), lines(0), date(0) {}
+
+    size_t Avail() const { return SIZE - len; }
+    void Reset() {
+        len = 0;
+        lines = 0;
+        date = 0;
+    }
+
+    size_t len;
+    int lines;
+    int32_t date;   // yyyymmdd
+    char data[SIZE];
+};
+
+/* 一个线程独占的日志缓冲(双缓冲):
+ * 本线程在 current 上追加，写满挂到 full 并换上 spare；
+ * 后台线程定期把 full 和非空的 current 整串换走，再补上空块。
+ * mtx 只在后台交换的一瞬间才会有竞争，各线程之间没有共享锁。 */
+struct ThreadLogBuffer {
+    ThreadLogBuffer(): exited(false) {}
+
+    std::mutex mtx;
+    std::unique_ptr<LogChunk> current;
+    std::unique_ptr<LogChunk> spare;
+    std::vector<std::unique_ptr<LogChunk>> full;
+    bool exited;    // 线程已退出，取空后由后台线程注销
+};
+
+#endif //LOG_BUFFER_H
@@ -0,0 +1,101 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+/* 一条日志占一个定长槽位，行内容直接格式化进槽位，不再为每行分配 string */
+struct LogRecord {
+    static const size_t SIZE = 512;
+    static const size_t HEAD = sizeof(std::atomic<size_t>) + sizeof(size_t) + 2 * sizeof(int32_t);
+    static const size_t DATA_SIZE = SIZE - HEAD;
+
+    std::atomic<size_t> seq;    // 槽位状态，见 LogRing
+    size_t pos;                 // 生产者抢到的位置
+    int32_t date;               // yyyymmdd，消费者据此按天切分文件
+    int32_t len;
+    char data[DATA_SIZE];
+};
+
+/* 多生产者单消费者无锁环形队列，槽位预先分配。
+ * 生产者 CAS 抢位置后在槽位里原地写，写完 Publish；
+ * 消费者按顺序 Peek 已发布的槽位，拷走后 Release 归还。
+ * 槽位序号的含义与 Vyukov 有界队列相同: pos 可写，pos + 1 可读。 */
+class LogRing {
+public:
+    explicit LogRing(size_t capacity)
+        : mask_(RoundUp_(capacity) - 1), records_(new LogRecord[mask_ + 1]),
+          enqueuePos_(0), dequeuePos_(0) {
+        for(size_t i = 0; i <= mask_; i++) {
+            records_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    /* 满时返回 nullptr */
+    LogRecord* Claim() {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            LogRecord* rec = &records_[pos & mask_];
+            size_t seq = rec->seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(dif == 0) {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    rec->pos = pos;
+                    return rec;
+                }
+            }
+            else if(dif < 0) { return nullptr; }
+            else { pos = enqueuePos_.load(std::memory_order_relaxed); }
+        }
+    }
+
+    void Publish(LogRecord* rec) {
+        rec->seq.store(rec->pos + 1, std::memory_order_release);
+    }
+
+    /* 只由消费者线程调用，下一条尚未发布时返回 nullptr */
+    LogRecord* Peek() {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        LogRecord* rec = &records_[pos & mask_];
+        if(rec->seq.load(std::memory_order_acquire) != pos + 1) { return nullptr; }
+        return rec;
+    }
+
+    void Release(LogRecord* rec) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        assert(rec == &records_[pos & mask_]);
+        rec->seq.store(pos + mask_ + 1, std::memory_order_release);
+        dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+    }
+
+    /* 近似值 */
+    size_t Size() const {
+        size_t e = enqueuePos_.load(std::memory_order_relaxed);
+        size_t d = dequeuePos_.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+
+private:
+    static size_t RoundUp_(size_t n) {
+        size_t cap = 2;
+        while(cap < n) { cap <<= 1; }
+        return cap;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<LogRecord[]> records_;
+    char pad0_[64];
+    std::atomic<size_t> enqueuePos_;
+    char pad1_[64];
+    std::atomic<size_t> dequeuePos_;    // 只有消费者修改
+};
+
+#endif //LOG_RING_H
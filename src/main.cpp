@@ -5,9 +5,18 @@ int main() {
     /* 守护进程 后台运行 */
     //daemon(1, 0); 
 
+    ServerOptions options;                  /* 其余选项见 ServerOptions 的默认值 */
+    options.ioBackend = Poller::EPOLL;      /* 事件后端: epoll 或 io_uring(不可用时退回 epoll) */
+    options.blobCacheMB = 32;               /* 小文件响应缓存(MB, 0 关闭) */
+    options.executorKind = Executor::WORK_STEALING;
+    options.timerKind = Timer::WHEEL;       /* 超时定时器: 小根堆或分层时间轮 */
+    options.logEngine = Log::RING;          /* 异步日志引擎: 无锁环形队列或线程本地缓冲 */
+    options.accessLogMB = 0;                /* 二进制访问日志分段大小(MB, 0 关闭)，用 bin/decodeAccessLog 查看 */
+
     WebServer server(
         1316, 3, 60000, false,             /* 端口 ET模式 timeoutMs 优雅退出  */
         9006, "han", "han", "webserver", /* Mysql配置 */
-        12, 6, true, 1, 1024);             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        12, 6, true, 1, 1024,             /* 连接池数量 线程池数量 日志开关 日志等级 日志异步队列容量 */
+        options);
     server.Start();
-} 
\ No newline at end of file
+} 
@@ -0,0 +1,10 @@
+#include "executor.h"
+#include "threadpool.h"
+#include "workstealpool.h"
+
+Executor* Executor::NewExecutor(int kind, size_t threadCount) {
+    if(kind == WORK_STEALING) {
+        return new WorkStealPool(threadCount);
+    }
+    return new ThreadPool(threadCount);
+}
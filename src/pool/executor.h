@@ -0,0 +1,29 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <stddef.h>
+
+#include "task.h"
+
+/* 任务执行器接口，由 WebServer 启动时按配置选择具体实现 */
+class Executor {
+public:
+    enum KIND {
+        THREAD_POOL = 0,    // 单队列 + 互斥锁 + 条件变量
+        WORK_STEALING,      // 每线程双端队列 + 无锁注入队列
+    };
+
+    virtual ~Executor() = default;
+
+    /* 任务以值传入，放不进 Task 内部缓冲区的可调用对象编译不过 */
+    virtual void AddTask(Task task) = 0;
+
+    /* 已提交尚未开始执行的任务数，近似值，用于过载判断 */
+    virtual size_t QueueSize() const = 0;
+
+    virtual const char* Name() const = 0;
+
+    static Executor* NewExecutor(int kind, size_t threadCount);
+};
+
+#endif //EXECUTOR_H
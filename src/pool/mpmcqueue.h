@@ -0,0 +1,94 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+/* 有界多生产者多消费者无锁队列(Dmitry Vyukov 的算法)。
+ * 每个槽位带一个序号，生产者/消费者各自 CAS 抢位置，槽位的序号决定能否读写，
+ * 不需要锁，也不会因为某个线程被挂起而阻塞其他线程抢其他槽位。
+ * 满时 Push 返回 false 且不移走 item，空时 Pop 返回 false。 */
+template<class T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity = 4096)
+        : mask_(RoundUp_(capacity) - 1), cells_(new Cell[mask_ + 1]),
+          enqueuePos_(0), dequeuePos_(0) {
+        for(size_t i = 0; i <= mask_; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    bool Push(T&& item) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(dif == 0) {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if(dif < 0) { return false; }
+            else { pos = enqueuePos_.load(std::memory_order_relaxed); }
+        }
+        cell->data = std::move(item);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T* item) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if(dif == 0) {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) { break; }
+            }
+            else if(dif < 0) { return false; }
+            else { pos = dequeuePos_.load(std::memory_order_relaxed); }
+        }
+        *item = std::move(cell->data);
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* 近似值，仅供统计 */
+    size_t Size() const {
+        size_t e = enqueuePos_.load(std::memory_order_relaxed);
+        size_t d = dequeuePos_.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    static size_t RoundUp_(size_t n) {
+        size_t cap = 2;
+        while(cap < n) { cap <<= 1; }
+        return cap;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    /* 生产者与消费者的位置分开放在不同缓存行 */
+    char pad0_[64];
+    std::atomic<size_t> enqueuePos_;
+    char pad1_[64];
+    std::atomic<size_t> dequeuePos_;
+    char pad2_[64];
+};
+
+#endif //MPMC_QUEUE_H
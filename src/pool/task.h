@@ -0,0 +1,94 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <stddef.h>
+#include <assert.h>
+
+/* 定长小缓冲区任务: 可调用对象直接放在内部 CAPACITY 字节里，构造、移动都不分配内存。
+ * 只能移动不能拷贝。放不下的可调用对象在编译期报错，
+ * 绑定 成员函数指针 + this + 两三个参数 的 std::bind 或等价 lambda 都放得下。 */
+class Task {
+public:
+    static const size_t CAPACITY = 48;
+
+    Task() noexcept: ops_(nullptr) {}
+
+    template<class F, class Fn = typename std::decay<F>::type,
+             class = typename std::enable_if<!std::is_same<Fn, Task>::value>::type>
+    Task(F&& func): ops_(&Ops<Fn>::table) {
+        static_assert(sizeof(Fn) <= CAPACITY, "callable too large for Task, capture less");
+        static_assert(alignof(Fn) <= alignof(Storage), "callable over-aligned for Task");
+        static_assert(std::is_nothrow_move_constructible<Fn>::value, "callable must be nothrow movable");
+        new (&storage_) Fn(std::forward<F>(func));
+    }
+
+    Task(Task&& other) noexcept: ops_(other.ops_) {
+        if(ops_) {
+            ops_->move(&other.storage_, &storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if(this != &other) {
+            Reset();
+            ops_ = other.ops_;
+            if(ops_) {
+                ops_->move(&other.storage_, &storage_);
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { Reset(); }
+
+    void operator()() {
+        assert(ops_);
+        ops_->invoke(&storage_);
+    }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void Reset() {
+        if(ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    typedef typename std::aligned_storage<CAPACITY, alignof(void*)>::type Storage;
+
+    /* 每种可调用类型一张静态函数表，Task 里只存一个指针 */
+    struct OpsTable {
+        void (*invoke)(void* self);
+        void (*move)(void* from, void* to);     // 移动构造到 to 并析构 from
+        void (*destroy)(void* self);
+    };
+
+    template<class Fn>
+    struct Ops {
+        static void Invoke(void* self) { (*static_cast<Fn*>(self))(); }
+        static void Move(void* from, void* to) {
+            new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        }
+        static void Destroy(void* self) { static_cast<Fn*>(self)->~Fn(); }
+        static const OpsTable table;
+    };
+
+    const OpsTable* ops_;
+    Storage storage_;
+};
+
+template<class Fn>
+const Task::OpsTable Task::Ops<Fn>::table = { &Ops<Fn>::Invoke, &Ops<Fn>::Move, &Ops<Fn>::Destroy };
+
+#endif //TASK_H
@@ -3,10 +3,15 @@
 
 #include <mutex>
 #include <condition_variable>
-#include <queue>
+#include <vector>
 #include <thread>
-#include <functional>
-class ThreadPool {
+#include <atomic>
+#include <memory>
+#include <assert.h>
+
+#include "executor.h"
+
+class ThreadPool : public Executor {
 public:
     explicit ThreadPool(size_t threadCount = 8): pool_(std::make_shared<Pool>()) {
             assert(threadCount > 0);
@@ -15,8 +20,8 @@ public:
                     std::unique_lock<std::mutex> locker(pool->mtx);
                     while(true) {
                         if(!pool->tasks.empty()) {
-                            auto task = std::move(pool->tasks.front());
-                            pool->tasks.pop();
+                            Task task = pool->tasks.pop();
+                            pool->pending.store(pool->tasks.size(), std::memory_order_relaxed);
                             locker.unlock();
                             task();
                             locker.lock();
@@ -42,21 +47,58 @@ public:
         }
     }
 
-    template<class F>
-    void AddTask(F&& task) {
+    void AddTask(Task task) override {
         {
             std::lock_guard<std::mutex> locker(pool_->mtx);
-            pool_->tasks.emplace(std::forward<F>(task));
+            pool_->tasks.push(std::move(task));
+            pool_->pending.store(pool_->tasks.size(), std::memory_order_relaxed);
         }
         pool_->cond.notify_one();
     }
 
+    size_t QueueSize() const override { return pool_->pending.load(std::memory_order_relaxed); }
+
+    const char* Name() const override { return "thread-pool"; }
+
 private:
+    /* 环形队列，满时翻倍扩容，稳定后入队出队都不分配内存 */
+    class TaskRing {
+    public:
+        TaskRing(): buff_(64), head_(0), count_(0) {}
+        bool empty() const { return count_ == 0; }
+        size_t size() const { return count_; }
+        void push(Task task) {
+            if(count_ == buff_.size()) { Grow_(); }
+            buff_[(head_ + count_) & (buff_.size() - 1)] = std::move(task);
+            count_++;
+        }
+        Task pop() {
+            assert(count_ > 0);
+            Task task = std::move(buff_[head_]);
+            head_ = (head_ + 1) & (buff_.size() - 1);
+            count_--;
+            return task;
+        }
+    private:
+        void Grow_() {
+            std::vector<Task> buff(buff_.size() * 2);
+            for(size_t i = 0; i < count_; i++) {
+                buff[i] = std::move(buff_[(head_ + i) & (buff_.size() - 1)]);
+            }
+            buff_.swap(buff);
+            head_ = 0;
+        }
+        std::vector<Task> buff_;
+        size_t head_;
+        size_t count_;
+    };
+
     struct Pool {
         std::mutex mtx;
         std::condition_variable cond;
         bool isClosed;
-        std::queue<std::function<void()>> tasks;
+        TaskRing tasks;
+        std::atomic<size_t> pending;    // tasks.size() 的副本，读取时不用加锁
     };
     std::shared_ptr<Pool> pool_;
 };
@@ -0,0 +1,93 @@
+#ifndef WORK_DEQUE_H
+#define WORK_DEQUE_H
+
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+#include <assert.h>
+
+/* Chase-Lev 工作窃取双端队列，内存序按 Lê et al. "Correct and Efficient
+ * Work-Stealing for Weak Memory Models" (PPoPP'13)。
+ * 只有所属线程调用 Push/Pop，在底部后进先出；其他线程 Steal 从顶部先进先出取走。
+ * 容量固定(2 的幂)，满时 Push 返回 false 由调用者另行安置。
+ * T 需为指针等可原子读写的类型。 */
+template<class T>
+class WorkDeque {
+public:
+    enum STEAL_RESULT {
+        EMPTY = 0,
+        SUCCESS,
+        ABORT,      // 与其他线程竞争失败，队列中可能仍有元素
+    };
+
+    explicit WorkDeque(size_t capacity = 1024)
+        : mask_(RoundUp_(capacity) - 1), buff_(mask_ + 1), top_(0), bottom_(0) {}
+
+    WorkDeque(const WorkDeque&) = delete;
+    WorkDeque& operator=(const WorkDeque&) = delete;
+
+    bool Push(T item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if(b - t > static_cast<int64_t>(mask_)) { return false; }
+        buff_[b & mask_].store(item, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T* item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if(t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        *item = buff_[b & mask_].load(std::memory_order_relaxed);
+        if(t == b) {
+            /* 只剩最后一个，与窃取者抢 top_ */
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    STEAL_RESULT Steal(T* item) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if(t >= b) { return EMPTY; }
+        *item = buff_[t & mask_].load(std::memory_order_relaxed);
+        if(!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+            return ABORT;
+        }
+        return SUCCESS;
+    }
+
+    /* 近似值，仅供统计 */
+    size_t Size() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+private:
+    static size_t RoundUp_(size_t n) {
+        size_t cap = 2;
+        while(cap < n) { cap <<= 1; }
+        return cap;
+    }
+
+    const size_t mask_;
+    std::vector<std::atomic<T>> buff_;
+    /* top_ 被窃取者修改，bottom_ 只被所属线程修改，分开放在不同缓存行 */
+    std::atomic<int64_t> top_;
+    char pad_[64];
+    std::atomic<int64_t> bottom_;
+};
+
+#endif //WORK_DEQUE_H
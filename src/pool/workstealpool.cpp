@@ -0,0 +1,216 @@
+#include "workstealpool.h"
+
+using namespace std;
+
+thread_local WorkStealPool* WorkStealPool::currentPool_ = nullptr;
+thread_local size_t WorkStealPool::currentIdx_ = 0;
+
+WorkStealPool::WorkStealPool(size_t threadCount, size_t injectCapacity)
+    : inject_(injectCapacity), spinCount_(thread::hardware_concurrency() > 1 ? SPIN_COUNT : 0),
+      isClosed_(false), sleepers_(0), epoch_(0) {
+    assert(threadCount > 0);
+    /* 所有队列建好再启动线程，窃取时不会看到未构造的 Worker */
+    for(size_t i = 0; i < threadCount; i++) {
+        workers_.emplace_back(new Worker);
+        workers_.back()->seed = static_cast<uint32_t>(i * 2654435761u + 1);
+    }
+    for(size_t i = 0; i < threadCount; i++) {
+        workers_[i]->thread = thread(&WorkStealPool::Run_, this, i);
+    }
+}
+
+WorkStealPool::~WorkStealPool() {
+    {
+        lock_guard<mutex> locker(mtx_);
+        isClosed_.store(true);
+        epoch_.fetch_add(1);
+    }
+    cond_.notify_all();
+    for(auto& worker: workers_) {
+        if(worker->thread.joinable()) { worker->thread.join(); }
+    }
+    /* 工作线程退出前已取空所有队列，节点都回到了空闲链表 */
+    for(auto& worker: workers_) {
+        TaskNode* node;
+        while(worker->deque.Pop(&node)) { delete node; }
+        DeleteList_(worker->freeList);
+        DeleteList_(worker->returned.exchange(nullptr));
+    }
+}
+
+void WorkStealPool::DeleteList_(TaskNode* node) {
+    while(node) {
+        TaskNode* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+bool WorkStealPool::IsOwner_(const Worker* worker) const {
+    return currentPool_ == this && workers_[currentIdx_].get() == worker;
+}
+
+WorkStealPool::TaskNode* WorkStealPool::AllocNode_(Worker& worker) {
+    if(!worker.freeList) {
+        worker.freeList = worker.returned.exchange(nullptr, memory_order_acquire);
+    }
+    TaskNode* node = worker.freeList;
+    if(node) {
+        worker.freeList = node->next;
+        return node;
+    }
+    node = new TaskNode;
+    node->owner = &worker;
+    return node;
+}
+
+void WorkStealPool::FreeNode_(TaskNode* node) {
+    Worker* owner = node->owner;
+    if(IsOwner_(owner)) {
+        node->next = owner->freeList;
+        owner->freeList = node;
+        return;
+    }
+    /* 只压栈、所属线程整串取走，没有 ABA 问题 */
+    TaskNode* head = owner->returned.load(memory_order_relaxed);
+    do {
+        node->next = head;
+    } while(!owner->returned.compare_exchange_weak(head, node, memory_order_release,
+                                                   memory_order_relaxed));
+}
+
+void WorkStealPool::AddTask(Task task) {
+    if(currentPool_ == this) {
+        Worker& self = *workers_[currentIdx_];
+        if(self.deque.Size() < LOCAL_CAPACITY) {
+            TaskNode* node = AllocNode_(self);
+            node->task = std::move(task);
+            if(self.deque.Push(node)) {
+                Wake_();
+                return;
+            }
+            task = std::move(node->task);
+            FreeNode_(node);
+        }
+    }
+    while(!inject_.Push(std::move(task))) {
+        /* 注入队列满: 工作线程都在忙，让出 CPU 等它们消化 */
+        Wake_();
+        this_thread::yield();
+    }
+    Wake_();
+}
+
+size_t WorkStealPool::QueueSize() const {
+    size_t n = inject_.Size();
+    for(auto& worker: workers_) {
+        n += worker->deque.Size();
+    }
+    return n;
+}
+
+void WorkStealPool::Wake_() {
+    /* 与 Run_ 中 sleepers_ 自增后的复查配对: 要么这里看到睡眠者，要么睡眠者复查时看到任务 */
+    atomic_thread_fence(memory_order_seq_cst);
+    if(sleepers_.load(memory_order_relaxed) > 0) {
+        {
+            lock_guard<mutex> locker(mtx_);
+            epoch_.fetch_add(1, memory_order_relaxed);
+        }
+        cond_.notify_one();
+    }
+}
+
+void WorkStealPool::Run_(size_t idx) {
+    currentPool_ = this;
+    currentIdx_ = idx;
+    Task task;
+    int idle = 0;
+    while(true) {
+        if(FindTask_(idx, &task)) {
+            task();
+            task.Reset();
+            idle = 0;
+            continue;
+        }
+        if(isClosed_.load(memory_order_acquire)) { break; }
+        if(++idle < spinCount_) {
+            if(idle > spinCount_ / 2) { this_thread::yield(); }
+            continue;
+        }
+
+        /* 先取 epoch 再登记睡眠，登记后复查一次队列，避免丢失唤醒 */
+        uint64_t epoch = epoch_.load(memory_order_acquire);
+        sleepers_.fetch_add(1, memory_order_seq_cst);
+        if(FindTask_(idx, &task)) {
+            sleepers_.fetch_sub(1, memory_order_relaxed);
+            task();
+            task.Reset();
+            idle = 0;
+            continue;
+        }
+        {
+            unique_lock<mutex> locker(mtx_);
+            cond_.wait(locker, [this, epoch] {
+                return epoch_.load(memory_order_relaxed) != epoch || isClosed_.load();
+            });
+        }
+        sleepers_.fetch_sub(1, memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+bool WorkStealPool::FindTask_(size_t idx, Task* task) {
+    Worker& self = *workers_[idx];
+    TaskNode* node;
+    if(self.deque.Pop(&node)) {
+        *task = std::move(node->task);
+        FreeNode_(node);
+        return true;
+    }
+
+    if(inject_.Pop(task)) {
+        /* 顺带多取几个放进自己的队列，空闲的线程可以从这里窃取 */
+        int moved = 0;
+        for(int i = 1; i < INJECT_BATCH && self.deque.Size() < LOCAL_CAPACITY / 2; i++) {
+            node = AllocNode_(self);
+            if(!inject_.Pop(&node->task)) {
+                FreeNode_(node);
+                break;
+            }
+            self.deque.Push(node);
+            moved++;
+        }
+        if(moved > 0) { Wake_(); }
+        return true;
+    }
+    return Steal_(idx, task);
+}
+
+bool WorkStealPool::Steal_(size_t idx, Task* task) {
+    size_t n = workers_.size();
+    if(n == 1) { return false; }
+    Worker& self = *workers_[idx];
+    bool retry = true;
+    while(retry) {
+        retry = false;
+        /* xorshift 随机起点，依次尝试其余线程 */
+        self.seed ^= self.seed << 13;
+        self.seed ^= self.seed >> 17;
+        self.seed ^= self.seed << 5;
+        size_t start = self.seed % n;
+        for(size_t i = 0; i < n; i++) {
+            size_t victim = (start + i) % n;
+            if(victim == idx) { continue; }
+            TaskNode* node;
+            WorkDeque<TaskNode*>::STEAL_RESULT ret = workers_[victim]->deque.Steal(&node);
+            if(ret == WorkDeque<TaskNode*>::SUCCESS) {
+                *task = std::move(node->task);
+                FreeNode_(node);
+                return true;
+            }
+            if(ret == WorkDeque<TaskNode*>::ABORT) { retry = true; }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,84 @@
+#ifndef WORK_STEAL_POOL_H
+#define WORK_STEAL_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <assert.h>
+
+#include "executor.h"
+#include "workdeque.h"
+#include "mpmcqueue.h"
+
+/* 工作窃取线程池
+ * 外部线程提交的任务按值存进无锁注入队列，工作线程内提交的任务装进节点放入自己的双端队列，
+ * 节点用完归还给分配它的线程复用，稳定后提交任务不分配内存。
+ * 工作线程取任务的顺序: 自己的队列(后进先出) -> 注入队列(一次取一小批)
+ * -> 随机挑其他线程窃取(先进先出)。
+ * 都取不到时先自旋一会儿，再登记为睡眠者并在条件变量上等 epoch 变化；
+ * 提交者只在有睡眠者时才加锁唤醒，忙时 AddTask 不碰锁也不调 notify。 */
+class WorkStealPool : public Executor {
+public:
+    explicit WorkStealPool(size_t threadCount = 8, size_t injectCapacity = 16384);
+
+    ~WorkStealPool();
+
+    void AddTask(Task task) override;
+
+    size_t QueueSize() const override;
+
+    const char* Name() const override { return "work-stealing"; }
+
+private:
+    struct Worker;
+
+    /* 双端队列里的元素，Chase-Lev 的槽位只能存可原子读写的指针 */
+    struct TaskNode {
+        Task task;
+        TaskNode* next;
+        Worker* owner;
+    };
+
+    struct Worker {
+        Worker(): deque(LOCAL_CAPACITY), seed(0), freeList(nullptr), returned(nullptr) {}
+        WorkDeque<TaskNode*> deque;
+        std::thread thread;
+        uint32_t seed;                      // 挑选窃取对象用的随机数状态
+        TaskNode* freeList;                 // 只有本线程读写
+        std::atomic<TaskNode*> returned;    // 其他线程归还的节点，本线程整串取走
+    };
+
+    void Run_(size_t idx);
+    bool FindTask_(size_t idx, Task* task);
+    bool Steal_(size_t idx, Task* task);
+    void Wake_();
+
+    TaskNode* AllocNode_(Worker& worker);
+    void FreeNode_(TaskNode* node);
+    bool IsOwner_(const Worker* worker) const;
+    static void DeleteList_(TaskNode* node);
+
+    static const size_t LOCAL_CAPACITY = 1024;
+    static const int INJECT_BATCH = 4;  // 从注入队列一次最多取走的任务数，多出的放进自己的队列供他人窃取
+    static const int SPIN_COUNT = 64;   // 睡眠前空转的轮数，后一半让出 CPU
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    MpmcQueue<Task> inject_;
+
+    int spinCount_;                 // 单核机器上空转只会拖住生产者，直接睡眠
+    std::atomic<bool> isClosed_;
+    std::atomic<int> sleepers_;
+    std::atomic<uint64_t> epoch_;   // 只在持有 mtx_ 时修改
+    std::mutex mtx_;
+    std::condition_variable cond_;
+
+    /* 当前线程所属的线程池及下标，用于判断提交者是否本池的工作线程 */
+    static thread_local WorkStealPool* currentPool_;
+    static thread_local size_t currentIdx_;
+};
+
+#endif //WORK_STEAL_POOL_H
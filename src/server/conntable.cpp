@@ -0,0 +1,47 @@
+#include "conntable.h"
+
+ConnTable::ConnTable(int maxFd): maxFd_(maxFd), blockCount_(0) {
+    assert(maxFd > 0);
+    size_t n = (maxFd + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+    blocks_.reset(new std::atomic<Slot*>[n]);
+    for(size_t i = 0; i < n; i++) {
+        blocks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ConnTable::~ConnTable() {
+    size_t n = (maxFd_ + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+    for(size_t i = 0; i < n; i++) {
+        delete[] blocks_[i].load(std::memory_order_relaxed);
+    }
+}
+
+HttpConn* ConnTable::Acquire(int fd) {
+    if(fd < 0 || fd >= maxFd_) { return nullptr; }
+    std::atomic<Slot*>& entry = blocks_[fd >> BLOCK_SHIFT];
+    Slot* block = entry.load(std::memory_order_acquire);
+    if(!block) {
+        /* 多个反应堆可能同时触发同一块的分配，CAS 失败的一方释放自己的 */
+        Slot* fresh = new Slot[BLOCK_SIZE];
+        if(entry.compare_exchange_strong(block, fresh, std::memory_order_acq_rel)) {
+            block = fresh;
+            blockCount_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            delete[] fresh;
+        }
+    }
+    return &block[fd & BLOCK_MASK].conn;
+}
+
+void ConnTable::Release(int fd) {
+    assert(fd >= 0 && fd < maxFd_);
+    Slot* block = blocks_[fd >> BLOCK_SHIFT].load(std::memory_order_acquire);
+    assert(block);
+    block[fd & BLOCK_MASK].gen.fetch_add(1, std::memory_order_acq_rel);
+}
+
+size_t ConnTable::MemoryUsage() const {
+    size_t n = (maxFd_ + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+    /* 每个 HttpConn 还各带两个初始 1KB 的缓冲区 */
+    return n * sizeof(std::atomic<Slot*>) + SlotCount() * (sizeof(Slot) + 2 * 1024);
+}
@@ -0,0 +1,93 @@
+#ifndef CONNTABLE_H
+#define CONNTABLE_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <assert.h>
+
+#include "../http/httpconn.h"
+
+/* 以 fd 为下标的连接槽位表，替代 unordered_map<int, HttpConn>
+ * 槽位按块(64 个)在第一次用到时整块分配，之后常驻复用，查找是纯数组下标。
+ * 每个槽位带一个代数: 连接关闭时加一，定时器/工作线程回调里携带的代数
+ * 与当前代数不一致即为过期回调(fd 已关闭或已被新连接复用)，直接丢弃。 */
+class ConnTable {
+public:
+    explicit ConnTable(int maxFd);
+
+    ~ConnTable();
+
+    /* 新连接占用 fd 对应的槽位，所在块未分配时分配，线程安全。
+     * fd 超出 maxFd 时返回 nullptr(调高了 RLIMIT_NOFILE，或日志、缓存等占用了大量 fd) */
+    HttpConn* Acquire(int fd);
+
+    /* O(1) 取槽位，所在块未分配过返回 nullptr */
+    HttpConn* Get(int fd) const {
+        assert(fd >= 0 && fd < maxFd_);
+        Slot* block = blocks_[fd >> BLOCK_SHIFT].load(std::memory_order_acquire);
+        return block ? &block[fd & BLOCK_MASK].conn : nullptr;
+    }
+
+    uint32_t Generation(int fd) const {
+        assert(fd >= 0 && fd < maxFd_);
+        Slot* block = blocks_[fd >> BLOCK_SHIFT].load(std::memory_order_acquire);
+        return block ? block[fd & BLOCK_MASK].gen.load(std::memory_order_acquire) : 0;
+    }
+
+    bool IsCurrent(int fd, uint32_t gen) const {
+        return Generation(fd) == gen;
+    }
+
+    /* 注册到 Poller 的句柄: 高 32 位代数，低 32 位槽位下标 */
+    uint64_t Handle(int fd) const {
+        return (static_cast<uint64_t>(Generation(fd)) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    /* 由事件句柄直接定位连接，代数不符(同一批事件里连接已关闭或 fd 已复用)返回 nullptr */
+    HttpConn* FromHandle(uint64_t handle) const {
+        uint32_t fd = static_cast<uint32_t>(handle);
+        if(fd >= static_cast<uint32_t>(maxFd_)) { return nullptr; }
+        Slot* block = blocks_[fd >> BLOCK_SHIFT].load(std::memory_order_acquire);
+        if(!block) { return nullptr; }
+        Slot& slot = block[fd & BLOCK_MASK];
+        if(slot.gen.load(std::memory_order_acquire) != static_cast<uint32_t>(handle >> 32)) {
+            return nullptr;
+        }
+        return &slot.conn;
+    }
+
+    /* 不对应任何槽位的句柄，留给监听 fd、eventfd 等 */
+    static uint64_t SpecialHandle(uint32_t id) {
+        return (static_cast<uint64_t>(id) << 32) | 0xFFFFFFFFu;
+    }
+
+    /* 连接关闭，代数加一使在途回调失效 */
+    void Release(int fd);
+
+    /* 已分配槽位占用的内存(字节)，不含缓冲区扩容部分 */
+    size_t MemoryUsage() const;
+
+    size_t SlotCount() const {
+        return blockCount_.load(std::memory_order_relaxed) << BLOCK_SHIFT;
+    }
+
+    static size_t SlotSize() { return sizeof(Slot); }
+
+private:
+    static const int BLOCK_SHIFT = 6;
+    static const int BLOCK_SIZE = 1 << BLOCK_SHIFT;
+    static const int BLOCK_MASK = BLOCK_SIZE - 1;
+
+    struct Slot {
+        HttpConn conn;
+        std::atomic<uint32_t> gen;
+        Slot(): gen(0) {}
+    };
+
+    int maxFd_;
+    std::unique_ptr<std::atomic<Slot*>[]> blocks_;
+    std::atomic<size_t> blockCount_;
+};
+
+#endif //CONNTABLE_H
@@ -1,6 +1,6 @@
 #include "epoller.h"
 
-Epoller::Epoller(int maxEvent):epollFd_(epoll_create(512)), events_(maxEvent){
+Epoller::Epoller(int maxEvent):epollFd_(epoll_create(512)), full_(false), events_(maxEvent){
     assert(epollFd_ >= 0 && events_.size() > 0);
 }
 
@@ -8,18 +8,18 @@ Epoller::~Epoller() {
     close(epollFd_);
 }
 
-bool Epoller::AddFd(int fd, uint32_t events) {
+bool Epoller::AddFd(int fd, uint32_t events, uint64_t data) {
     if(fd < 0) return false;
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.u64 = data;
     ev.events = events;
     return 0 == epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
 }
 
-bool Epoller::ModFd(int fd, uint32_t events) {
+bool Epoller::ModFd(int fd, uint32_t events, uint64_t data) {
     if(fd < 0) return false;
     epoll_event ev = {0};
-    ev.data.fd = fd;
+    ev.data.u64 = data;
     ev.events = events;
     return 0 == epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
 }
@@ -31,12 +31,19 @@ bool Epoller::DelFd(int fd) {
 }
 
 int Epoller::Wait(int timeoutMs) {
-    return epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
+    if(full_) {
+        /* 上一次取满了，扩容后再取；不能在分发途中扩容，调用方还在读 events_ */
+        events_.resize(std::min(events_.size() * 2, MAX_EVENT_CAPACITY));
+        full_ = false;
+    }
+    int n = epoll_wait(epollFd_, &events_[0], static_cast<int>(events_.size()), timeoutMs);
+    full_ = (n == static_cast<int>(events_.size()) && events_.size() < MAX_EVENT_CAPACITY);
+    return n;
 }
 
-int Epoller::GetEventFd(size_t i) const {
+uint64_t Epoller::GetEventData(size_t i) const {
     assert(i < events_.size() && i >= 0);
-    return events_[i].data.fd;
+    return events_[i].data.u64;
 }
 
 uint32_t Epoller::GetEvents(size_t i) const {
@@ -6,29 +6,35 @@
 #include <unistd.h> // close()
 #include <assert.h> // close()
 #include <vector>
+#include <algorithm> // min()
 #include <errno.h>
+#include "poller.h"
 
-class Epoller {
+class Epoller : public Poller {
 public:
     explicit Epoller(int maxEvent = 1024);
 
-    ~Epoller();
+    ~Epoller() override;
 
-    bool AddFd(int fd, uint32_t events);
+    bool AddFd(int fd, uint32_t events, uint64_t data) override;
 
-    bool ModFd(int fd, uint32_t events);
+    bool ModFd(int fd, uint32_t events, uint64_t data) override;
 
-    bool DelFd(int fd);
+    bool DelFd(int fd) override;
 
-    int Wait(int timeoutMs = -1);
+    int Wait(int timeoutMs = -1) override;
 
-    int GetEventFd(size_t i) const;
+    uint64_t GetEventData(size_t i) const override;
 
-    uint32_t GetEvents(size_t i) const;
+    uint32_t GetEvents(size_t i) const override;
+
+    const char* Name() const override { return "epoll"; }
         
 private:
     int epollFd_;
 
+    bool full_;
+
     std::vector<struct epoll_event> events_;    
 };
 
@@ -0,0 +1,209 @@
+#include "eventloop.h"
+
+using namespace std;
+
+const uint64_t EventLoop::LISTEN_HANDLE = ConnTable::SpecialHandle(0);
+const uint64_t EventLoop::WAKEUP_HANDLE = ConnTable::SpecialHandle(1);
+
+EventLoop::EventLoop(int timeoutMS, uint32_t connEvent, int ioBackend, int timerKind, ConnTable* users):
+            timeoutMS_(timeoutMS), connEvent_(connEvent), isClose_(false),
+            wakeupFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+            listenFd_(-1), listenEvent_(0), maxConn_(0), nowMs_(NowMs()),
+            timer_(Timer::NewTimer(timerKind, 1024)), epoller_(Poller::NewPoller(ioBackend)),
+            users_(users) {
+    assert(wakeupFd_ >= 0 && users_);
+    epoller_->AddFd(wakeupFd_, EPOLLIN, WAKEUP_HANDLE);
+}
+
+EventLoop::~EventLoop() {
+    if(listenFd_ >= 0) { close(listenFd_); }
+    close(wakeupFd_);
+}
+
+void EventLoop::Loop() {
+    int timeMS = -1;
+    while(!isClose_) {
+        if(timeoutMS_ > 0) {
+            timeMS = timer_->GetNextTick();
+        }
+        int eventCnt = epoller_->Wait(timeMS);
+        nowMs_ = NowMs();
+        for(int i = 0; i < eventCnt; i++) {
+            uint64_t data = epoller_->GetEventData(i);
+            uint32_t events = epoller_->GetEvents(i);
+            if(data == LISTEN_HANDLE) {
+                DealListen_();
+                continue;
+            }
+            else if(data == WAKEUP_HANDLE) {
+                HandleWakeup_();
+                continue;
+            }
+            HttpConn* client = users_->FromHandle(data);
+            if(!client) {
+                continue;
+            }
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                CloseConn_(client);
+            }
+            else if(events & EPOLLIN) {
+                OnRead_(client);
+            }
+            else if(events & EPOLLOUT) {
+                OnWrite_(client, true);
+            } else {
+                LOG_ERROR("Unexpected event");
+            }
+        }
+    }
+}
+
+void EventLoop::Quit() {
+    isClose_ = true;
+    Wakeup_();
+}
+
+void EventLoop::QueueConn(int fd, const sockaddr_in& addr) {
+    {
+        lock_guard<mutex> locker(mtx_);
+        pending_.push_back({fd, addr});
+    }
+    Wakeup_();
+}
+
+bool EventLoop::SetListenFd(int listenFd, uint32_t listenEvent, int maxConn) {
+    assert(listenFd > 0 && listenFd_ < 0);
+    if(!epoller_->AddListenFd(listenFd, listenEvent | EPOLLIN, LISTEN_HANDLE)) {
+        return false;
+    }
+    listenFd_ = listenFd;
+    listenEvent_ = listenEvent;
+    maxConn_ = maxConn;
+    return true;
+}
+
+void EventLoop::Wakeup_() {
+    uint64_t one = 1;
+    if(::write(wakeupFd_, &one, sizeof(one)) != sizeof(one)) {
+        LOG_WARN("EventLoop wakeup error: %d", errno);
+    }
+}
+
+void EventLoop::HandleWakeup_() {
+    uint64_t cnt = 0;
+    if(::read(wakeupFd_, &cnt, sizeof(cnt)) != sizeof(cnt)) {
+        return;
+    }
+    vector<PendingConn> conns;
+    {
+        lock_guard<mutex> locker(mtx_);
+        conns.swap(pending_);
+    }
+    for(auto& item: conns) {
+        AddClient_(item.fd, item.addr);
+    }
+}
+
+void EventLoop::DealListen_() {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    do {
+        int fd = epoller_->Accept(listenFd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK);
+        if(fd <= 0) { return; }
+        else if(HttpConn::userCount >= maxConn_) {
+            SendError_(fd);
+            LOG_WARN("Clients is full!");
+            return;
+        }
+        AddClient_(fd, addr);
+    } while(listenEvent_ & EPOLLET);
+}
+
+void EventLoop::SendError_(int fd) {
+    const char info[] = "Server busy!";
+    send(fd, info, sizeof(info) - 1, MSG_NOSIGNAL);
+    close(fd);
+}
+
+void EventLoop::AddClient_(int fd, const sockaddr_in& addr) {
+    assert(fd > 0);
+    HttpConn* client = users_->Acquire(fd);
+    if(!client) {
+        SendError_(fd);
+        LOG_WARN("Client fd %d exceeds ConnTable size", fd);
+        return;
+    }
+    client->init(fd, addr);
+    client->Touch(nowMs_);
+    if(timeoutMS_ > 0) {
+        timer_->add(fd, timeoutMS_, std::bind(&EventLoop::CloseExpired_, this, fd, users_->Generation(fd)));
+    }
+    epoller_->AddFd(fd, EPOLLIN | connEvent_, users_->Handle(fd));
+}
+
+void EventLoop::CloseConn_(HttpConn* client) {
+    assert(client);
+    /* 开启二进制访问日志时连接进出由 HttpConn 记录 */
+    if(!AccessLog::Instance()->IsOpen()) { LOG_INFO("Client[%d] quit!", client->GetFd()); }
+    if(timeoutMS_ > 0) { timer_->cancel(client->GetFd()); }
+    users_->Release(client->GetFd());
+    epoller_->DelFd(client->GetFd());
+    client->Close();
+}
+
+void EventLoop::CloseExpired_(int fd, uint32_t gen) {
+    /* fd 已关闭或已被新连接复用 */
+    if(!users_->IsCurrent(fd, gen)) { return; }
+    HttpConn* client = users_->Get(fd);
+    /* 读写时只记时间不动定时器，到期时才核对: 期间有过活动就按剩余时长重新挂上 */
+    int64_t idle = NowMs() - client->LastActive();
+    if(idle < timeoutMS_) {
+        timer_->add(fd, static_cast<int>(timeoutMS_ - idle), std::bind(&EventLoop::CloseExpired_, this, fd, gen));
+        return;
+    }
+    CloseConn_(client);
+}
+
+void EventLoop::ExtentTime_(HttpConn* client) {
+    assert(client);
+    client->Touch(nowMs_);
+}
+
+void EventLoop::OnRead_(HttpConn* client) {
+    assert(client);
+    ExtentTime_(client);
+    int readErrno = 0;
+    ssize_t ret = client->read(&readErrno);
+    if(ret <= 0 && readErrno != EAGAIN) {
+        CloseConn_(client);
+        return;
+    }
+    /* 同线程内直接尝试写出响应，只有写不完时才注册 EPOLLOUT */
+    if(client->process()) {
+        OnWrite_(client, false);
+    }
+}
+
+void EventLoop::OnWrite_(HttpConn* client, bool outArmed) {
+    assert(client);
+    if(outArmed) { ExtentTime_(client); }
+    while(true) {
+        int writeErrno = 0;
+        ssize_t ret = client->write(&writeErrno);
+        if(client->ToWriteBytes() == 0) {
+            /* 传输完成 */
+            if(client->IsKeepAlive()) {
+                if(client->process()) { continue; }
+                if(outArmed) { epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, users_->Handle(client->GetFd())); }
+                return;
+            }
+        }
+        else if(ret > 0 || writeErrno == EAGAIN) {
+            /* 继续传输 */
+            if(!outArmed) { epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, users_->Handle(client->GetFd())); }
+            return;
+        }
+        break;
+    }
+    CloseConn_(client);
+}
@@ -0,0 +1,78 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <sys/eventfd.h> // eventfd()
+#include <unistd.h>      // close()
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>  // accept4()
+#include <netinet/in.h>
+
+#include "poller.h"
+#include "../log/log.h"
+#include "../timer/timer.h"
+#include "../http/httpconn.h"
+#include "conntable.h"
+
+/* 从反应堆: one loop per thread
+ * 每个 loop 独占自己的 Poller、Timer 和一部分连接(ConnTable 中的槽位)，
+ * 连接上的读、解析、写都在本线程内完成，不经过线程池 */
+class EventLoop {
+public:
+    EventLoop(int timeoutMS, uint32_t connEvent, int ioBackend, int timerKind, ConnTable* users);
+
+    ~EventLoop();
+
+    void Loop();
+
+    void Quit();
+
+    /* 线程安全：主反应堆通过 eventfd 唤醒本 loop 接收新连接 */
+    void QueueConn(int fd, const sockaddr_in& addr);
+
+    /* SO_REUSEPORT 模式: 本 loop 持有自己的监听 socket，自行 accept */
+    bool SetListenFd(int listenFd, uint32_t listenEvent, int maxConn);
+
+private:
+    static const uint64_t LISTEN_HANDLE;
+    static const uint64_t WAKEUP_HANDLE;
+
+    struct PendingConn {
+        int fd;
+        sockaddr_in addr;
+    };
+
+    void Wakeup_();
+    void HandleWakeup_();
+
+    void DealListen_();
+    void AddClient_(int fd, const sockaddr_in& addr);
+    void SendError_(int fd);
+    void CloseConn_(HttpConn* client);
+    void CloseExpired_(int fd, uint32_t gen);
+    void ExtentTime_(HttpConn* client);
+
+    void OnRead_(HttpConn* client);
+    void OnWrite_(HttpConn* client, bool outArmed);
+
+    int timeoutMS_;
+    uint32_t connEvent_;
+    std::atomic<bool> isClose_;
+    int wakeupFd_;
+    int listenFd_;
+    uint32_t listenEvent_;
+    int maxConn_;
+    int64_t nowMs_;     // 本轮事件循环开始的时间，读写事件只把它记到连接上
+
+    std::unique_ptr<Timer> timer_;
+    std::unique_ptr<Poller> epoller_;
+    ConnTable* users_;   // 与其他 loop 共享，但每个 fd 只由一个 loop 访问
+
+    std::mutex mtx_;
+    std::vector<PendingConn> pending_;
+};
+
+#endif //EVENTLOOP_H
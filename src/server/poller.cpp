@@ -0,0 +1,21 @@
+#include "poller.h"
+#include "epoller.h"
+#include "uringpoller.h"
+
+/* std::min 按引用取参，需要类外定义 */
+const size_t Poller::MAX_EVENT_CAPACITY;
+
+int Poller::Accept(int listenFd, struct sockaddr* addr, socklen_t* len, int flags) {
+    return accept4(listenFd, addr, len, flags);
+}
+
+Poller* Poller::NewPoller(int backend, int maxEvent) {
+    if(backend == IO_URING) {
+        UringPoller* poller = new UringPoller(maxEvent);
+        if(poller->IsValid()) {
+            return poller;
+        }
+        delete poller;
+    }
+    return new Epoller(maxEvent);
+}
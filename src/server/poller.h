@@ -0,0 +1,51 @@
+#ifndef POLLER_H
+#define POLLER_H
+
+#include <sys/epoll.h> // EPOLLIN EPOLLOUT ...
+#include <sys/socket.h> // accept4()
+#include <stdint.h>
+#include <stddef.h>
+
+/* 事件后端接口: 事件掩码沿用 epoll 的 EPOLLxxx 语义
+ * 由 WebServer 启动时选择具体实现
+ * 注册时带一个 64 位不透明句柄(见 ConnTable::Handle)，事件返回时原样交回，
+ * 分发时不需要再由 fd 查找连接 */
+class Poller {
+public:
+    enum BACKEND {
+        EPOLL = 0,
+        IO_URING,
+    };
+
+    virtual ~Poller() = default;
+
+    virtual bool AddFd(int fd, uint32_t events, uint64_t data) = 0;
+
+    virtual bool ModFd(int fd, uint32_t events, uint64_t data) = 0;
+
+    virtual bool DelFd(int fd) = 0;
+
+    /* 注册监听 fd: io_uring 下挂 multishot accept，其余同 AddFd，用 DelFd 删除 */
+    virtual bool AddListenFd(int fd, uint32_t events, uint64_t data) { return AddFd(fd, events, data); }
+
+    /* 取一个新连接，没有时返回 -1 且 errno 为 EAGAIN
+     * io_uring 下从 multishot accept 已收下的连接里取，否则直接 accept4 */
+    virtual int Accept(int listenFd, struct sockaddr* addr, socklen_t* len, int flags);
+
+    virtual int Wait(int timeoutMs = -1) = 0;
+
+    virtual uint64_t GetEventData(size_t i) const = 0;
+
+    virtual uint32_t GetEvents(size_t i) const = 0;
+
+    virtual const char* Name() const = 0;
+
+    /* io_uring 不可用时退回 epoll */
+    static Poller* NewPoller(int backend, int maxEvent = 1024);
+
+protected:
+    /* 一次 Wait 填满事件数组时扩容，下次能取回更多事件 */
+    static const size_t MAX_EVENT_CAPACITY = 65536;
+};
+
+#endif //POLLER_H
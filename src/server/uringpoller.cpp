@@ -0,0 +1,430 @@
+#include "uringpoller.h"
+
+using namespace std;
+
+UringPoller::UringPoller(int maxEvent): ringFd_(-1), multishot_(false), multishotAccept_(false),
+            sqPtr_(MAP_FAILED), sqMapSize_(0), cqPtr_(MAP_FAILED), cqMapSize_(0),
+            sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)), sqesMapSize_(0),
+            sqLocalTail_(0), batch_(0), full_(false), listenFd_(-1), events_(maxEvent) {
+    assert(events_.size() > 0);
+    if(!Setup_(1024)) {
+        Release_();
+    }
+}
+
+UringPoller::~UringPoller() {
+    for(int fd: accepted_) {
+        close(fd);
+    }
+    Release_();
+}
+
+bool UringPoller::Setup_(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+    ringFd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if(ringFd_ < 0) {
+        return false;
+    }
+    /* Wait 的超时依赖 IORING_ENTER_EXT_ARG (5.11+) */
+    if(!(params.features & IORING_FEAT_EXT_ARG)) {
+        return false;
+    }
+    sqMapSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqMapSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMap) {
+        sqMapSize_ = cqMapSize_ = max(sqMapSize_, cqMapSize_);
+    }
+    sqPtr_ = mmap(nullptr, sqMapSize_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if(sqPtr_ == MAP_FAILED) {
+        return false;
+    }
+    if(singleMap) {
+        cqPtr_ = sqPtr_;
+    } else {
+        cqPtr_ = mmap(nullptr, cqMapSize_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if(cqPtr_ == MAP_FAILED) {
+            return false;
+        }
+    }
+    sqesMapSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesMapSize_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+    if(sqes_ == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sqPtr_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqLocalTail_ = *sqTail_;
+    /* SQE 下标与 SQ 槽位一一对应 */
+    for(unsigned i = 0; i < sqEntries_; i++) {
+        sqArray_[i] = i;
+    }
+
+    char* cq = static_cast<char*>(cqPtr_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    Probe_();
+    return true;
+}
+
+void UringPoller::Probe_() {
+    /* 对一个可读的 eventfd 各提交一次 multishot poll 和 multishot accept:
+     * 不认识这些标志位的内核直接返回 EINVAL，
+     * 支持的内核 poll 立即完成并带 IORING_CQE_F_MORE，accept 因为不是 socket 返回 ENOTSOCK */
+    const uint64_t PROBE_POLL = 1, PROBE_ACCEPT = 2, PROBE_REMOVE = 3;
+    int efd = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(efd < 0) { return; }
+    io_uring_sqe* sqe = GetSqeLocked_();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = efd;
+    sqe->poll32_events = EPOLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = PROBE_POLL;
+    __atomic_store_n(sqTail_, ++sqLocalTail_, __ATOMIC_RELEASE);
+    sqe = GetSqeLocked_();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = efd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = PROBE_ACCEPT;
+    __atomic_store_n(sqTail_, ++sqLocalTail_, __ATOMIC_RELEASE);
+    sqe = GetSqeLocked_();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = PROBE_POLL;
+    sqe->user_data = PROBE_REMOVE;
+    __atomic_store_n(sqTail_, ++sqLocalTail_, __ATOMIC_RELEASE);
+
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    struct __kernel_timespec ts = {0, 10 * 1000000LL};
+    arg.ts = reinterpret_cast<uint64_t>(&ts);
+    bool pollDone = false, acceptDone = false, removeDone = false;
+    unsigned toSubmit = 3;
+    /* 都是立即完成的操作，超时只是兜底 */
+    for(int i = 0; i < 10 && !(pollDone && acceptDone && removeDone); i++) {
+        int ret = syscall(__NR_io_uring_enter, ringFd_, toSubmit, 1,
+                        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        if(ret < 0 && errno != ETIME && errno != EINTR) { break; }
+        if(ret > 0) { toSubmit -= min(toSubmit, static_cast<unsigned>(ret)); }
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for(; head != tail; head++) {
+            const io_uring_cqe* cqe = &cqes_[head & cqMask_];
+            if(cqe->user_data == PROBE_POLL) {
+                if(cqe->res > 0 && (cqe->flags & IORING_CQE_F_MORE)) { multishot_ = true; }
+                pollDone = !(cqe->flags & IORING_CQE_F_MORE);
+            } else if(cqe->user_data == PROBE_ACCEPT) {
+                multishotAccept_ = cqe->res == -ENOTSOCK;
+                acceptDone = true;
+            } else if(cqe->user_data == PROBE_REMOVE) {
+                removeDone = true;
+            }
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+    close(efd);
+}
+
+void UringPoller::Release_() {
+    if(sqes_ != MAP_FAILED) {
+        munmap(sqes_, sqesMapSize_);
+        sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    }
+    if(cqPtr_ != MAP_FAILED && cqPtr_ != sqPtr_) {
+        munmap(cqPtr_, cqMapSize_);
+    }
+    cqPtr_ = MAP_FAILED;
+    if(sqPtr_ != MAP_FAILED) {
+        munmap(sqPtr_, sqMapSize_);
+        sqPtr_ = MAP_FAILED;
+    }
+    if(ringFd_ >= 0) {
+        close(ringFd_);
+        ringFd_ = -1;
+    }
+}
+
+UringPoller::FdState* UringPoller::State_(int fd) {
+    if(static_cast<size_t>(fd) >= states_.size()) {
+        states_.resize(fd + 1, FdState{0, 0, 0, 0, 0, false, false, false, false});
+    }
+    return &states_[fd];
+}
+
+io_uring_sqe* UringPoller::GetSqeLocked_() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if(sqLocalTail_ - head >= sqEntries_) {
+        /* SQ 满了先提交一次 */
+        SubmitLocked_();
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if(sqLocalTail_ - head >= sqEntries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqLocalTail_ & sqMask_];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void UringPoller::ArmLocked_(int fd, FdState* st) {
+    io_uring_sqe* sqe = GetSqeLocked_();
+    if(!sqe) { return; }
+    if(st->acceptor) {
+        /* 每收下一个连接一个完成事件，res 为新连接的 fd */
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK;
+        sqe->user_data = UserData_(fd, st->gen) | ACCEPT_TAG;
+        __atomic_store_n(sqTail_, ++sqLocalTail_, __ATOMIC_RELEASE);
+        st->armed = true;
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = st->events & (EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLRDHUP);
+    if(st->multishot) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+    sqe->user_data = UserData_(fd, st->gen);
+    __atomic_store_n(sqTail_, ++sqLocalTail_, __ATOMIC_RELEASE);
+    st->armed = true;
+}
+
+void UringPoller::RemoveLocked_(FdState* st, int fd) {
+    if(!st->armed) { return; }
+    io_uring_sqe* sqe = GetSqeLocked_();
+    if(!sqe) { return; }
+    if(st->acceptor) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = UserData_(fd, st->gen) | ACCEPT_TAG;
+    } else {
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = UserData_(fd, st->gen);
+    }
+    sqe->fd = -1;
+    sqe->user_data = IGNORE_DATA;
+    __atomic_store_n(sqTail_, ++sqLocalTail_, __ATOMIC_RELEASE);
+    st->armed = false;
+}
+
+int UringPoller::SubmitLocked_() {
+    unsigned pending = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if(pending == 0) { return 0; }
+    return syscall(__NR_io_uring_enter, ringFd_, pending, 0, 0, nullptr, 0);
+}
+
+bool UringPoller::AddFd(int fd, uint32_t events, uint64_t data) {
+    if(fd < 0) return false;
+    lock_guard<mutex> locker(mtx_);
+    FdState* st = State_(fd);
+    if(st->active) { return false; }
+    st->active = true;
+    st->data = data;
+    st->events = events;
+    st->gen++;
+    st->multishot = multishot_ && (events & EPOLLET) && !(events & EPOLLONESHOT);
+    st->acceptor = false;
+    ArmLocked_(fd, st);
+    /* 事件循环线程里的修改随下一次 Wait 一起提交 */
+    if(owner_ != this_thread::get_id()) { SubmitLocked_(); }
+    return st->armed;
+}
+
+bool UringPoller::ModFd(int fd, uint32_t events, uint64_t data) {
+    if(fd < 0) return false;
+    lock_guard<mutex> locker(mtx_);
+    FdState* st = State_(fd);
+    if(!st->active) { return false; }
+    RemoveLocked_(st, fd);
+    st->data = data;
+    st->events = events;
+    st->gen++;
+    st->multishot = multishot_ && (events & EPOLLET) && !(events & EPOLLONESHOT);
+    st->acceptor = false;
+    ArmLocked_(fd, st);
+    if(owner_ != this_thread::get_id()) { SubmitLocked_(); }
+    return st->armed;
+}
+
+bool UringPoller::AddListenFd(int fd, uint32_t events, uint64_t data) {
+    if(fd < 0) return false;
+    {
+        lock_guard<mutex> locker(mtx_);
+        /* 只接管一个监听 fd，其余和不支持 multishot accept 时一样挂 poll */
+        if(multishotAccept_ && (listenFd_ < 0 || listenFd_ == fd)) {
+            FdState* st = State_(fd);
+            if(st->active) { return false; }
+            st->active = true;
+            st->data = data;
+            st->events = events & ~EPOLLONESHOT;
+            st->gen++;
+            st->multishot = false;
+            st->acceptor = true;
+            listenFd_ = fd;
+            ArmLocked_(fd, st);
+            if(owner_ != this_thread::get_id()) { SubmitLocked_(); }
+            return st->armed;
+        }
+    }
+    return AddFd(fd, events, data);
+}
+
+int UringPoller::Accept(int listenFd, struct sockaddr* addr, socklen_t* len, int flags) {
+    int fd = -1;
+    {
+        lock_guard<mutex> locker(mtx_);
+        if(listenFd == listenFd_) {
+            if(accepted_.empty()) {
+                errno = EAGAIN;
+                return -1;
+            }
+            fd = accepted_.front();
+            accepted_.pop_front();
+        }
+    }
+    if(fd < 0) {
+        return Poller::Accept(listenFd, addr, len, flags);
+    }
+    /* multishot accept 的各个完成共用一个地址缓冲区，所以没让内核填地址 */
+    if(addr && getpeername(fd, addr, len) < 0) {
+        memset(addr, 0, *len);
+    }
+    if(!(flags & SOCK_NONBLOCK)) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    }
+    return fd;
+}
+
+bool UringPoller::DelFd(int fd) {
+    if(fd < 0) return false;
+    lock_guard<mutex> locker(mtx_);
+    FdState* st = State_(fd);
+    if(!st->active) { return false; }
+    RemoveLocked_(st, fd);
+    st->active = false;
+    st->gen++;
+    if(owner_ != this_thread::get_id()) { SubmitLocked_(); }
+    return true;
+}
+
+int UringPoller::Wait(int timeoutMs) {
+    unsigned toSubmit = 0;
+    {
+        lock_guard<mutex> locker(mtx_);
+        owner_ = this_thread::get_id();
+        if(full_) {
+            events_.resize(min(events_.size() * 2, MAX_EVENT_CAPACITY));
+            full_ = false;
+        }
+        /* LT 语义: 上一轮交付过的 fd 重新挂 poll，仍就绪的会立即完成 */
+        for(int fd: rearm_) {
+            FdState* st = &states_[fd];
+            if(st->active && !st->armed && !(st->events & EPOLLONESHOT)) {
+                ArmLocked_(fd, st);
+            }
+        }
+        rearm_.clear();
+        if(__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_ || ListenReadyLocked_()) {
+            /* CQ 里还有没取走的事件或还有没取走的连接，不阻塞 */
+            SubmitLocked_();
+            return Reap_();
+        }
+        toSubmit = sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    }
+
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    struct __kernel_timespec ts;
+    if(timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    int ret = syscall(__NR_io_uring_enter, ringFd_, toSubmit, 1,
+                    IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if(ret < 0 && errno != ETIME && errno != EINTR) {
+        return -1;
+    }
+    lock_guard<mutex> locker(mtx_);
+    return Reap_();
+}
+
+bool UringPoller::ListenReadyLocked_() const {
+    return listenFd_ >= 0 && !accepted_.empty() && states_[listenFd_].active;
+}
+
+int UringPoller::Reap_() {
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    size_t cnt = 0;
+    batch_++;
+    while(head != tail && cnt < events_.size()) {
+        const io_uring_cqe* cqe = &cqes_[head & cqMask_];
+        head++;
+        if(cqe->user_data == IGNORE_DATA) { continue; }
+        int fd = static_cast<int>((cqe->user_data & ~ACCEPT_TAG) >> 32);
+        uint32_t gen = static_cast<uint32_t>(cqe->user_data);
+        if(static_cast<size_t>(fd) >= states_.size()) { continue; }
+        if((cqe->user_data & ACCEPT_TAG) && cqe->res >= 0) {
+            /* 内核已经建好的连接不能丢，注册已删除(暂停 accept)时也先收下 */
+            accepted_.push_back(cqe->res);
+        }
+        FdState* st = &states_[fd];
+        if(!st->active || st->gen != gen) {
+            /* 已删除或已修改的注册 */
+            continue;
+        }
+        if(!(cqe->flags & IORING_CQE_F_MORE)) {
+            st->armed = false;
+            if(!(st->events & EPOLLONESHOT)) { rearm_.push_back(fd); }
+        }
+        if(cqe->res == -ECANCELED || (cqe->user_data & ACCEPT_TAG)) {
+            /* 监听 fd 的事件按队列是否为空在最后统一报告 */
+            continue;
+        }
+        uint32_t revents = cqe->res < 0 ? (EPOLLERR | EPOLLHUP) : static_cast<uint32_t>(cqe->res);
+
+        /* 同一 fd 在一批里的多次完成合并成一个事件，与 epoll 一致 */
+        if(st->batch == batch_) {
+            events_[st->slot].events |= revents;
+            continue;
+        }
+        st->batch = batch_;
+        st->slot = cnt;
+        events_[cnt].data.u64 = st->data;
+        events_[cnt].events = revents;
+        cnt++;
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    if(ListenReadyLocked_() && cnt < events_.size()) {
+        events_[cnt].data.u64 = states_[listenFd_].data;
+        events_[cnt].events = EPOLLIN;
+        cnt++;
+    }
+    full_ = (cnt == events_.size() && events_.size() < MAX_EVENT_CAPACITY);
+    return static_cast<int>(cnt);
+}
+
+uint64_t UringPoller::GetEventData(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].data.u64;
+}
+
+uint32_t UringPoller::GetEvents(size_t i) const {
+    assert(i < events_.size() && i >= 0);
+    return events_[i].events;
+}
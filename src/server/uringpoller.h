@@ -0,0 +1,129 @@
+#ifndef URINGPOLLER_H
+#define URINGPOLLER_H
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h> // syscall()
+#include <sys/mman.h>    // mmap()
+#include <sys/eventfd.h> // eventfd()
+#include <fcntl.h>       // fcntl()
+#include <unistd.h>      // close()
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "poller.h"
+
+/* 5.19 引入，旧头文件里没有 */
+#ifndef IORING_ACCEPT_MULTISHOT
+#define IORING_ACCEPT_MULTISHOT (1U << 0)
+#endif
+
+/* io_uring 事件后端
+ * 注册/修改/删除都只是往 SQ 里放一个 POLL_ADD/POLL_REMOVE，
+ * 和下一次 Wait 合并成一次 io_uring_enter 提交，省掉每次 epoll_ctl 的系统调用。
+ * LT 的 fd 在事件交付后于下一次 Wait 时自动重新挂 poll（若仍就绪会立即完成），
+ * ET 的 fd 用 multishot poll，EPOLLONESHOT 的 fd 交付后等待 ModFd 重新注册。
+ * 监听 fd 挂一个 multishot accept，内核收下的连接先排在队列里，
+ * 队列非空时按 LT 报告监听 fd 可读，由 Accept 取走，接连接不再需要 accept 系统调用。
+ * multishot poll/accept 是否可用在 Setup_ 时实测，不支持时分别退回单次 poll 和 accept4。 */
+class UringPoller : public Poller {
+public:
+    explicit UringPoller(int maxEvent = 1024);
+
+    ~UringPoller() override;
+
+    /* 内核不支持或被 seccomp 禁用时为 false */
+    bool IsValid() const { return ringFd_ >= 0; }
+
+    bool AddFd(int fd, uint32_t events, uint64_t data) override;
+
+    bool ModFd(int fd, uint32_t events, uint64_t data) override;
+
+    bool DelFd(int fd) override;
+
+    bool AddListenFd(int fd, uint32_t events, uint64_t data) override;
+
+    int Accept(int listenFd, struct sockaddr* addr, socklen_t* len, int flags) override;
+
+    int Wait(int timeoutMs = -1) override;
+
+    uint64_t GetEventData(size_t i) const override;
+
+    uint32_t GetEvents(size_t i) const override;
+
+    const char* Name() const override { return "io_uring"; }
+
+private:
+    struct FdState {
+        uint64_t data;    // 注册时的句柄
+        uint32_t events;
+        uint32_t gen;     // 注册代数，写在 user_data 里用来丢弃过期完成事件
+        uint32_t batch;   // 最近一次出现在哪一批 Reap_ 中
+        uint32_t slot;    // 该批中在 events_ 的下标
+        bool active;
+        bool armed;       // 内核里是否挂着 poll
+        bool multishot;
+        bool acceptor;    // 挂的是 multishot accept 而不是 poll
+    };
+
+    bool Setup_(unsigned entries);
+    void Probe_();
+    void Release_();
+
+    FdState* State_(int fd);
+    void ArmLocked_(int fd, FdState* st);
+    void RemoveLocked_(FdState* st, int fd);
+    io_uring_sqe* GetSqeLocked_();
+    int SubmitLocked_();
+    bool ListenReadyLocked_() const;
+    int Reap_();
+
+    static uint64_t UserData_(int fd, uint32_t gen) {
+        return (static_cast<uint64_t>(fd) << 32) | gen;
+    }
+
+    static const uint64_t IGNORE_DATA = ~0ull;
+    /* fd 非负，user_data 最高位空着，用来标记 accept 的完成事件 */
+    static const uint64_t ACCEPT_TAG = 1ull << 63;
+
+    int ringFd_;
+    bool multishot_;
+    bool multishotAccept_;
+
+    /* SQ/CQ 共享内存 */
+    void* sqPtr_;
+    size_t sqMapSize_;
+    void* cqPtr_;
+    size_t cqMapSize_;
+    io_uring_sqe* sqes_;
+    size_t sqesMapSize_;
+
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned* sqArray_;
+    unsigned sqLocalTail_;
+
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    std::mutex mtx_;
+    std::thread::id owner_;
+    uint32_t batch_;
+    bool full_;
+    std::vector<FdState> states_;
+    std::vector<int> rearm_;
+    int listenFd_;
+    std::deque<int> accepted_;   // multishot accept 已收下、尚未被 Accept 取走的连接
+    std::vector<struct epoll_event> events_;
+};
+
+#endif //URINGPOLLER_H
@@ -2,44 +2,116 @@
 
 using namespace std;
 
+const uint64_t WebServer::LISTEN_HANDLE = ConnTable::SpecialHandle(0);
+const uint64_t WebServer::WAKEUP_HANDLE = ConnTable::SpecialHandle(1);
+
+/* 过载时的响应，事先拼好，主线程直接 send，不进任务队列 */
+const char WebServer::BUSY_RESPONSE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Retry-After: 1\r\n"
+    "Content-length: 0\r\n"
+    "Connection: close\r\n\r\n";
+
 WebServer::WebServer(
             int port, int trigMode, int timeoutMS, bool OptLinger,
             int sqlPort, const char* sqlUser, const  char* sqlPwd,
             const char* dbName, int connPoolNum, int threadNum,
-            bool openLog, int logLevel, int logQueSize):
-            port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false),
-            timer_(new HeapTimer()), threadpool_(new ThreadPool(threadNum)), epoller_(new Epoller())
+            bool openLog, int logLevel, int logQueSize,
+            const ServerOptions& options):
+            port_(port), openLinger_(OptLinger), timeoutMS_(timeoutMS), isClose_(false), listenFd_(-1),
+            reusePort_(options.reusePort), cpuAffinity_(options.cpuAffinity), backlog_(options.backlog),
+            queueHighWater_(options.queueHighWater > 0 ? options.queueHighWater : 0),
+            queueLowWater_(options.queueLowWater > 0 && options.queueLowWater < options.queueHighWater ?
+                           options.queueLowWater : options.queueHighWater / 2),
+            listenPaused_(false), shedCount_(0), nowMs_(NowMs()),
+            wakeupFd_(-1),
+            timer_(Timer::NewTimer(options.timerKind, 1024)), epoller_(Poller::NewPoller(options.ioBackend)),
+            users_(new ConnTable(MAX_FD)), nextLoop_(0)
     {
     srcDir_ = getcwd(nullptr, 256);
     assert(srcDir_);
     strncat(srcDir_, "/resources/", 16);
     HttpConn::userCount = 0;
     HttpConn::srcDir = srcDir_;
+    HttpConn::pipelineDepth = options.pipelineDepth > 0 ? options.pipelineDepth : 1;
+    HttpRequest::maxBodySize = static_cast<size_t>(options.maxBodyMB) << 20;
+    FileCache::Instance()->Init(2000, 4096);   /* 静态文件缓存: TTL 2s, 最多 4096 项 */
+    BlobCache::Instance()->Init(static_cast<size_t>(options.blobCacheMB) << 20, 64 * 1024);
+    int preloaded = options.warmUp ? BlobCache::Instance()->Preload(srcDir_) : 0;
+    RegisterDefaultRoutes(Router::Instance());
     SqlConnPool::Instance()->Init("localhost", sqlPort, sqlUser, sqlPwd, dbName, connPoolNum);
 
     InitEventMode_(trigMode);
+    if(options.subReactorNum > 0) {
+        /* 连接只属于一个线程，不再需要 EPOLLONESHOT */
+        for(int i = 0; i < options.subReactorNum; i++) {
+            subLoops_.emplace_back(new EventLoop(timeoutMS_, connEvent_ & ~EPOLLONESHOT, options.ioBackend, options.timerKind,
+                                                users_.get()));
+        }
+    } else {
+        executor_.reset(Executor::NewExecutor(options.executorKind, threadNum));
+        wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(wakeupFd_ < 0 || !epoller_->AddFd(wakeupFd_, EPOLLIN, WAKEUP_HANDLE)) {
+            isClose_ = true;
+        }
+    }
     if(!InitSocket_()) { isClose_ = true;}
 
     if(openLog) {
-        Log::Instance()->init(logLevel, "./log", ".log", logQueSize);
+        Log::Instance()->init(logLevel, "./log", ".log", logQueSize, options.logEngine);
+        /* 开启后连接进出和每个请求只写二进制记录，不再写文本日志 */
+        AccessLog::Instance()->Init("./log", options.accessLogMB);
         if(isClose_) { LOG_ERROR("========== Server init error!=========="); }
         else {
             LOG_INFO("========== Server init ==========");
             LOG_INFO("Port:%d, OpenLinger: %s", port_, OptLinger? "true":"false");
+            LOG_INFO("Backlog: %d, ReusePort: %s, CpuAffinity: %s", backlog_,
+                            reusePort_ ? "true":"false", cpuAffinity_ ? "true":"false");
             LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
                             (listenEvent_ & EPOLLET ? "ET": "LT"),
                             (connEvent_ & EPOLLET ? "ET": "LT"));
-            LOG_INFO("LogSys level: %d", logLevel);
+            LOG_INFO("Event backend: %s, timer: %s", epoller_->Name(), timer_->Name());
+            if(options.ioBackend == Poller::IO_URING && strcmp(epoller_->Name(), "io_uring") != 0) {
+                LOG_WARN("io_uring unavailable, fall back to epoll");
+            }
+            LOG_INFO("LogSys level: %d, engine: %s", logLevel,
+                            logQueSize <= 0 ? "sync" : (options.logEngine == Log::THREAD_BUFFER ? "thread buffer" : "ring"));
+            LOG_INFO("Pipeline depth: %d, max body: %dMB", HttpConn::pipelineDepth, options.maxBodyMB);
             LOG_INFO("srcDir: %s", HttpConn::srcDir);
-            LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPoolNum, threadNum);
+            if(BlobCache::Instance()->IsOpen()) {
+                LOG_INFO("BlobCache: budget %dMB, preloaded %d files, %dKB",
+                            options.blobCacheMB, preloaded, (int)(BlobCache::Instance()->Bytes() / 1024));
+            }
+            if(AccessLog::Instance()->IsOpen()) {
+                LOG_INFO("AccessLog: binary, %dMB segments", options.accessLogMB);
+            }
+            LOG_INFO("ConnTable: max fd %d, slot size %d bytes", MAX_FD, (int)ConnTable::SlotSize());
+            if(subLoops_.empty()) {
+                LOG_INFO("SqlConnPool num: %d, %s num: %d", connPoolNum, executor_->Name(), threadNum);
+                if(queueHighWater_ > 0) {
+                    LOG_INFO("Task queue watermark: high %d, low %d", (int)queueHighWater_, (int)queueLowWater_);
+                }
+            } else {
+                LOG_INFO("SqlConnPool num: %d, SubReactor num: %d", connPoolNum, options.subReactorNum);
+            }
         }
     }
 }
 
 WebServer::~WebServer() {
-    close(listenFd_);
+    if(listenFd_ >= 0) { close(listenFd_); }
+    if(wakeupFd_ >= 0) { close(wakeupFd_); }
     isClose_ = true;
+    for(auto& loop: subLoops_) { loop->Quit(); }
+    for(auto& t: loopThreads_) {
+        if(t.joinable()) { t.join(); }
+    }
     free(srcDir_);
+    LOG_INFO("FileCache hits:%d, misses:%d", (int)FileCache::Instance()->Hits(),
+                (int)FileCache::Instance()->Misses());
+    LOG_INFO("BlobCache hits:%d, misses:%d", (int)BlobCache::Instance()->Hits(),
+                (int)BlobCache::Instance()->Misses());
+    if(queueHighWater_ > 0) { LOG_INFO("Shed %d requests with 503", (int)shedCount_); }
     SqlConnPool::Instance()->ClosePool();
 }
 
@@ -70,30 +142,54 @@ void WebServer::InitEventMode_(int trigMode) {
 
 void WebServer::Start() {
     int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
+    Router::Instance()->Compile();  /* 构造之后、启动之前可继续注册路由 */
     if(!isClose_) { LOG_INFO("========== Server start =========="); }
+    for(auto& loop: subLoops_) {
+        loopThreads_.emplace_back(&EventLoop::Loop, loop.get());
+        if(cpuAffinity_) { BindCpu_(loopThreads_.back(), loopThreads_.size() - 1); }
+    }
+    if(!isClose_ && reusePort_) {
+        /* 各从反应堆自行 accept，主线程无事可做 */
+        for(auto& t: loopThreads_) { t.join(); }
+        return;
+    }
     while(!isClose_) {
         if(timeoutMS_ > 0) {
             timeMS = timer_->GetNextTick();
         }
+        if(listenPaused_ && (timeMS < 0 || timeMS > RESUME_CHECK_MS)) {
+            timeMS = RESUME_CHECK_MS;
+        }
         int eventCnt = epoller_->Wait(timeMS);
+        nowMs_ = NowMs();
+        if(listenPaused_ && executor_->QueueSize() <= queueLowWater_) {
+            ResumeListen_();
+        }
         for(int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
-            int fd = epoller_->GetEventFd(i);
+            uint64_t data = epoller_->GetEventData(i);
             uint32_t events = epoller_->GetEvents(i);
-            if(fd == listenFd_) {
+            if(data == LISTEN_HANDLE) {
                 DealListen_();
+                continue;
+            }
+            else if(data == WAKEUP_HANDLE) {
+                HandleWakeup_();
+                continue;
             }
-            else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                assert(users_.count(fd) > 0);
-                CloseConn_(&users_[fd]);
+            HttpConn* client = users_->FromHandle(data);
+            if(!client) {
+                /* 本批次中该连接已关闭 */
+                continue;
+            }
+            if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                CloseConn_(client);
             }
             else if(events & EPOLLIN) {
-                assert(users_.count(fd) > 0);
-                DealRead_(&users_[fd]);
+                DealRead_(client);
             }
             else if(events & EPOLLOUT) {
-                assert(users_.count(fd) > 0);
-                DealWrite_(&users_[fd]);
+                DealWrite_(client);
             } else {
                 LOG_ERROR("Unexpected event");
             }
@@ -110,63 +206,171 @@ void WebServer::SendError_(int fd, const char*info) {
     close(fd);
 }
 
+bool WebServer::Overloaded_() const {
+    return queueHighWater_ > 0 && executor_ && executor_->QueueSize() >= queueHighWater_;
+}
+
+void WebServer::PauseListen_() {
+    if(listenPaused_) { return; }
+    /* 新连接留在内核 backlog 里，恢复时重新 AddFd，ET 模式下也会重新报告就绪 */
+    epoller_->DelFd(listenFd_);
+    listenPaused_ = true;
+    LOG_WARN("Task queue %d reached high watermark %d, pause accepting, shed %d so far",
+                (int)executor_->QueueSize(), (int)queueHighWater_, (int)shedCount_);
+}
+
+void WebServer::ResumeListen_() {
+    if(!listenPaused_) { return; }
+    if(!epoller_->AddListenFd(listenFd_, listenEvent_ | EPOLLIN, LISTEN_HANDLE)) {
+        LOG_ERROR("Resume listen error!");
+        return;
+    }
+    listenPaused_ = false;
+    LOG_INFO("Task queue %d back to low watermark %d, resume accepting, shed %d so far",
+                (int)executor_->QueueSize(), (int)queueLowWater_, (int)shedCount_);
+}
+
+void WebServer::ShedConn_(HttpConn* client) {
+    assert(client);
+    int fd = client->GetFd();
+    /* 先读掉已到达的请求: 带着未读数据 close 会发 RST，客户端可能收不到 503 */
+    char buf[4096];
+    for(int i = 0; i < 16 && recv(fd, buf, sizeof(buf), 0) > 0; i++) {}
+    if(send(fd, BUSY_RESPONSE, sizeof(BUSY_RESPONSE) - 1, MSG_NOSIGNAL) < 0) {
+        LOG_DEBUG("send 503 to client[%d] error!", fd);
+    }
+    shedCount_++;
+    CloseConn_(client);
+}
+
 void WebServer::CloseConn_(HttpConn* client) {
     assert(client);
-    LOG_INFO("Client[%d] quit!", client->GetFd());
+    /* 开启二进制访问日志时连接进出由 HttpConn 记录 */
+    if(!AccessLog::Instance()->IsOpen()) { LOG_INFO("Client[%d] quit!", client->GetFd()); }
+    /* 立即删掉定时器，不留到超时再靠代数过滤 */
+    if(timeoutMS_ > 0) { timer_->cancel(client->GetFd()); }
+    users_->Release(client->GetFd());
     epoller_->DelFd(client->GetFd());
     client->Close();
 }
 
+void WebServer::QueueClose_(HttpConn* client) {
+    assert(client);
+    {
+        std::lock_guard<std::mutex> locker(closeMtx_);
+        closing_.emplace_back(client->GetFd(), users_->Generation(client->GetFd()));
+    }
+    uint64_t one = 1;
+    if(::write(wakeupFd_, &one, sizeof(one)) != sizeof(one)) {
+        LOG_WARN("WebServer wakeup error: %d", errno);
+    }
+}
+
+void WebServer::HandleWakeup_() {
+    uint64_t cnt = 0;
+    if(::read(wakeupFd_, &cnt, sizeof(cnt)) != sizeof(cnt)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> locker(closeMtx_);
+        closeBatch_.swap(closing_);
+    }
+    for(auto& item: closeBatch_) {
+        /* 连接在排队期间可能已被超时或对端挂断关闭 */
+        if(users_->IsCurrent(item.first, item.second)) {
+            CloseConn_(users_->Get(item.first));
+        }
+    }
+    closeBatch_.clear();
+}
+
+void WebServer::CloseExpired_(int fd, uint32_t gen) {
+    /* fd 已关闭或已被新连接复用 */
+    if(!users_->IsCurrent(fd, gen)) { return; }
+    HttpConn* client = users_->Get(fd);
+    /* 读写时只记时间不动定时器，到期时才核对: 期间有过活动就按剩余时长重新挂上 */
+    int64_t idle = NowMs() - client->LastActive();
+    if(idle < timeoutMS_) {
+        timer_->add(fd, static_cast<int>(timeoutMS_ - idle), std::bind(&WebServer::CloseExpired_, this, fd, gen));
+        return;
+    }
+    CloseConn_(client);
+}
+
 void WebServer::AddClient_(int fd, sockaddr_in addr) {
     assert(fd > 0);
-    users_[fd].init(fd, addr);
+    HttpConn* client = users_->Acquire(fd);
+    if(!client) {
+        SendError_(fd, "Server busy!");
+        LOG_WARN("Client fd %d exceeds ConnTable size %d", fd, MAX_FD);
+        return;
+    }
+    client->init(fd, addr);
+    client->Touch(nowMs_);
     if(timeoutMS_ > 0) {
-        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseConn_, this, &users_[fd]));
+        timer_->add(fd, timeoutMS_, std::bind(&WebServer::CloseExpired_, this, fd, users_->Generation(fd)));
     }
-    epoller_->AddFd(fd, EPOLLIN | connEvent_);
-    SetFdNonblock(fd);
-    LOG_INFO("Client[%d] in!", users_[fd].GetFd());
+    epoller_->AddFd(fd, EPOLLIN | connEvent_, users_->Handle(fd));
+    /* 开启二进制访问日志时连接进出由 HttpConn 记录 */
+    if(!AccessLog::Instance()->IsOpen()) { LOG_INFO("Client[%d] in!", client->GetFd()); }
 }
 
 void WebServer::DealListen_() {
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
     do {
-        int fd = accept(listenFd_, (struct sockaddr *)&addr, &len);
+        if(Overloaded_()) {
+            PauseListen_();
+            return;
+        }
+        /* 新连接直接以非阻塞方式接受，io_uring 后端下由 multishot accept 预先收好 */
+        int fd = epoller_->Accept(listenFd_, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK);
         if(fd <= 0) { return;}
         else if(HttpConn::userCount >= MAX_FD) {
             SendError_(fd, "Server busy!");
-            LOG_WARN("Clients is full!");
+            LOG_WARN("Clients is full! ConnTable slots:%d, memory:%dKB",
+                        (int)users_->SlotCount(), (int)(users_->MemoryUsage() / 1024));
             return;
         }
+        if(!subLoops_.empty()) {
+            subLoops_[nextLoop_++ % subLoops_.size()]->QueueConn(fd, addr);
+            continue;
+        }
         AddClient_(fd, addr);
     } while(listenEvent_ & EPOLLET);
 }
 
 void WebServer::DealRead_(HttpConn* client) {
     assert(client);
+    if(Overloaded_()) {
+        /* 已在处理中的响应(DealWrite_)照常完成，只拒绝新请求 */
+        PauseListen_();
+        ShedConn_(client);
+        return;
+    }
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnRead_, this, client));
+    executor_->AddTask(std::bind(&WebServer::OnRead_, this, client, users_->Generation(client->GetFd())));
 }
 
 void WebServer::DealWrite_(HttpConn* client) {
     assert(client);
     ExtentTime_(client);
-    threadpool_->AddTask(std::bind(&WebServer::OnWrite_, this, client));
+    executor_->AddTask(std::bind(&WebServer::OnWrite_, this, client, users_->Generation(client->GetFd())));
 }
 
 void WebServer::ExtentTime_(HttpConn* client) {
     assert(client);
-    if(timeoutMS_ > 0) { timer_->adjust(client->GetFd(), timeoutMS_); }
+    client->Touch(nowMs_);
 }
 
-void WebServer::OnRead_(HttpConn* client) {
+void WebServer::OnRead_(HttpConn* client, uint32_t gen) {
     assert(client);
+    if(!users_->IsCurrent(client->GetFd(), gen)) { return; }
     int ret = -1;
     int readErrno = 0;
     ret = client->read(&readErrno);
     if(ret <= 0 && readErrno != EAGAIN) {
-        CloseConn_(client);
+        QueueClose_(client);
         return;
     }
     OnProcess(client);
@@ -174,14 +378,15 @@ void WebServer::OnRead_(HttpConn* client) {
 
 void WebServer::OnProcess(HttpConn* client) {
     if(client->process()) {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, users_->Handle(client->GetFd()));
     } else {
-        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN);
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLIN, users_->Handle(client->GetFd()));
     }
 }
 
-void WebServer::OnWrite_(HttpConn* client) {
+void WebServer::OnWrite_(HttpConn* client, uint32_t gen) {
     assert(client);
+    if(!users_->IsCurrent(client->GetFd(), gen)) { return; }
     int ret = -1;
     int writeErrno = 0;
     ret = client->write(&writeErrno);
@@ -192,24 +397,58 @@ void WebServer::OnWrite_(HttpConn* client) {
             return;
         }
     }
-    else if(ret < 0) {
-        if(writeErrno == EAGAIN) {
-            /* 继续传输 */
-            epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT);
-            return;
-        }
+    else if(ret > 0 || writeErrno == EAGAIN) {
+        /* 继续传输: ET 写到 EAGAIN 为止，LT 每轮最多剩 10KB 未写 */
+        epoller_->ModFd(client->GetFd(), connEvent_ | EPOLLOUT, users_->Handle(client->GetFd()));
+        return;
     }
-    CloseConn_(client);
+    QueueClose_(client);
 }
 
 /* Create listenFd */
 bool WebServer::InitSocket_() {
-    int ret;
-    struct sockaddr_in addr;
     if(port_ > 65535 || port_ < 1024) {
         LOG_ERROR("Port:%d error!",  port_);
         return false;
     }
+    if(reusePort_ && subLoops_.empty()) {
+        LOG_WARN("SO_REUSEPORT needs sub reactors, fall back to one listen socket");
+        reusePort_ = false;
+    }
+
+    if(reusePort_) {
+        /* 每个从反应堆一个 SO_REUSEPORT 监听 socket，由内核做连接负载均衡 */
+        for(auto& loop: subLoops_) {
+            int fd = CreateListenFd_();
+            if(fd < 0) { return false; }
+            if(!loop->SetListenFd(fd, listenEvent_, MAX_FD)) {
+                LOG_ERROR("Add listen error!");
+                close(fd);
+                return false;
+            }
+        }
+        listenFd_ = -1;
+        LOG_INFO("Server port:%d, reuseport listeners:%d", port_, (int)subLoops_.size());
+        return true;
+    }
+
+    listenFd_ = CreateListenFd_();
+    if(listenFd_ < 0) {
+        return false;
+    }
+    int ret = epoller_->AddListenFd(listenFd_,  listenEvent_ | EPOLLIN, LISTEN_HANDLE);
+    if(ret == 0) {
+        LOG_ERROR("Add listen error!");
+        close(listenFd_);
+        return false;
+    }
+    LOG_INFO("Server port:%d", port_);
+    return true;
+}
+
+int WebServer::CreateListenFd_() {
+    int ret;
+    struct sockaddr_in addr;
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(port_);
@@ -220,51 +459,65 @@ bool WebServer::InitSocket_() {
         optLinger.l_linger = 1;
     }
 
-    listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
-    if(listenFd_ < 0) {
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenFd < 0) {
         LOG_ERROR("Create socket error!", port_);
-        return false;
+        return -1;
     }
 
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if(ret < 0) {
-        close(listenFd_);
+        close(listenFd);
         LOG_ERROR("Init linger error!", port_);
-        return false;
+        return -1;
     }
 
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if(ret == -1) {
         LOG_ERROR("set socket setsockopt error !");
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
+    }
+
+    if(reusePort_) {
+        ret = setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int));
+        if(ret == -1) {
+            LOG_ERROR("set SO_REUSEPORT error !");
+            close(listenFd);
+            return -1;
+        }
     }
 
-    ret = bind(listenFd_, (struct sockaddr *)&addr, sizeof(addr));
+    ret = bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
     if(ret < 0) {
         LOG_ERROR("Bind Port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
 
-    ret = listen(listenFd_, 6);
+    ret = listen(listenFd, backlog_);
     if(ret < 0) {
         LOG_ERROR("Listen port:%d error!", port_);
-        close(listenFd_);
-        return false;
+        close(listenFd);
+        return -1;
     }
-    ret = epoller_->AddFd(listenFd_,  listenEvent_ | EPOLLIN);
-    if(ret == 0) {
-        LOG_ERROR("Add listen error!");
-        close(listenFd_);
-        return false;
+    SetFdNonblock(listenFd);
+    return listenFd;
+}
+
+void WebServer::BindCpu_(std::thread& t, size_t idx) {
+    long cpuNum = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cpuNum <= 0) { return; }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(idx % cpuNum, &cpus);
+    int ret = pthread_setaffinity_np(t.native_handle(), sizeof(cpus), &cpus);
+    if(ret != 0) {
+        LOG_WARN("Bind SubReactor[%d] to cpu %d error: %d", (int)idx, (int)(idx % cpuNum), ret);
     }
-    SetFdNonblock(listenFd_);
-    LOG_INFO("Server port:%d", port_);
-    return true;
 }
 
 int WebServer::SetFdNonblock(int fd) {
@@ -1,7 +1,13 @@
 #ifndef WEBSERVER_H
 #define WEBSERVER_H
 
-#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <utility>
+#include <sys/eventfd.h> // eventfd()
+#include <pthread.h>     // pthread_setaffinity_np()
+#include <sched.h>       // cpu_set_t
 #include <fcntl.h>       // fcntl()
 #include <unistd.h>      // close()
 #include <assert.h>
@@ -10,13 +16,35 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-#include "epoller.h"
+#include "poller.h"
+#include "eventloop.h"
+#include "conntable.h"
 #include "../log/log.h"
-#include "../timer/heaptimer.h"
+#include "../timer/timer.h"
 #include "../pool/sqlconnpool.h"
-#include "../pool/threadpool.h"
+#include "../pool/executor.h"
 #include "../pool/sqlconnRAII.h"
 #include "../http/httpconn.h"
+#include "../http/handlers.h"
+
+/* 在原有构造参数之外的可选配置，按名字赋值，新选项加在这里而不是继续追加构造参数 */
+struct ServerOptions {
+    int subReactorNum = 0;          // 从反应堆数量，0 为线程池模式
+    bool reusePort = false;         // 每个从反应堆一个 SO_REUSEPORT 监听 fd
+    bool cpuAffinity = false;       // 事件循环线程绑核
+    int backlog = 1024;             // listen backlog
+    int ioBackend = Poller::EPOLL;  // Poller::BACKEND，io_uring 不可用时退回 epoll
+    int blobCacheMB = 32;           // 小文件响应缓存，0 关闭
+    bool warmUp = true;             // 启动时预加载 resources/
+    int pipelineDepth = 16;         // 一批最多处理的流水线请求数
+    int maxBodyMB = 8;              // 请求体上限
+    int executorKind = Executor::WORK_STEALING;
+    int queueHighWater = 4096;      // 任务队列达到高水位暂停 accept 并回复 503，0 不限
+    int queueLowWater = 1024;       // 回落到低水位恢复 accept
+    int timerKind = Timer::WHEEL;   // Timer::KIND
+    int logEngine = Log::RING;      // 异步日志引擎 Log::ENGINE
+    int accessLogMB = 0;            // 二进制访问日志分段大小，0 关闭
+};
 
 class WebServer {
 public:
@@ -24,13 +52,20 @@ public:
         int port, int trigMode, int timeoutMS, bool OptLinger, 
         int sqlPort, const char* sqlUser, const  char* sqlPwd, 
         const char* dbName, int connPoolNum, int threadNum,
-        bool openLog, int logLevel, int logQueSize);
+        bool openLog, int logLevel, int logQueSize,
+        const ServerOptions& options = ServerOptions());
 
     ~WebServer();
     void Start();
 
+    /* 过载保护统计: 任务队列当前深度、被 503 拒绝的请求数 */
+    size_t QueueDepth() const { return executor_ ? executor_->QueueSize() : 0; }
+    size_t ShedCount() const { return shedCount_; }
+
 private:
     bool InitSocket_(); 
+    int CreateListenFd_();
+    void BindCpu_(std::thread& t, size_t idx);
     void InitEventMode_(int trigMode);
     void AddClient_(int fd, sockaddr_in addr);
   
@@ -39,14 +74,27 @@ private:
     void DealRead_(HttpConn* client);
 
     void SendError_(int fd, const char*info);
+    bool Overloaded_() const;
+    void PauseListen_();
+    void ResumeListen_();
+    void ShedConn_(HttpConn* client);
     void ExtentTime_(HttpConn* client);
     void CloseConn_(HttpConn* client);
+    void CloseExpired_(int fd, uint32_t gen);
 
-    void OnRead_(HttpConn* client);
-    void OnWrite_(HttpConn* client);
+    /* 工作线程不直接关闭连接: 经 eventfd 交给主线程关闭，定时器只由主线程访问 */
+    void QueueClose_(HttpConn* client);
+    void HandleWakeup_();
+
+    void OnRead_(HttpConn* client, uint32_t gen);
+    void OnWrite_(HttpConn* client, uint32_t gen);
     void OnProcess(HttpConn* client);
 
     static const int MAX_FD = 65536;
+    static const uint64_t LISTEN_HANDLE;
+    static const uint64_t WAKEUP_HANDLE;
+    static const int RESUME_CHECK_MS = 10;  /* 暂停 accept 期间检查队列是否回落的间隔 */
+    static const char BUSY_RESPONSE[];
 
     static int SetFdNonblock(int fd);
 
@@ -56,14 +104,38 @@ private:
     bool isClose_;
     int listenFd_;
     char* srcDir_;
+
+    bool reusePort_;
+    bool cpuAffinity_;
+    int backlog_;
     
     uint32_t listenEvent_;
     uint32_t connEvent_;
+
+    /* 过载保护(仅线程池模式): 任务队列达到高水位时暂停 accept、新请求直接回复 503，
+     * 回落到低水位后恢复 accept */
+    size_t queueHighWater_;
+    size_t queueLowWater_;
+    bool listenPaused_;
+    std::atomic<size_t> shedCount_;
+
+    int64_t nowMs_;     /* 本轮事件循环开始的时间，读写事件只把它记到连接上 */
+
+    /* 工作线程提交的待关闭连接(fd, 代数) */
+    int wakeupFd_;
+    std::mutex closeMtx_;
+    std::vector<std::pair<int, uint32_t>> closing_;
+    std::vector<std::pair<int, uint32_t>> closeBatch_;
    
-    std::unique_ptr<HeapTimer> timer_;
-    std::unique_ptr<ThreadPool> threadpool_;
-    std::unique_ptr<Epoller> epoller_;
-    std::unordered_map<int, HttpConn> users_;
+    std::unique_ptr<Timer> timer_;
+    std::unique_ptr<Executor> executor_;
+    std::unique_ptr<Poller> epoller_;
+    std::unique_ptr<ConnTable> users_;
+
+    /* one loop per thread 模式: 主反应堆只 accept，连接分发给从反应堆 */
+    size_t nextLoop_;
+    std::vector<std::unique_ptr<EventLoop>> subLoops_;
+    std::vector<std::thread> loopThreads_;
 };
 
 
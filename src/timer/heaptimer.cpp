@@ -2,12 +2,12 @@
 
 void HeapTimer::siftup_(size_t i) {
     assert(i >= 0 && i < heap_.size());
-    size_t j = (i - 1) / 2;
-    while(j >= 0) {
+    /* size_t 下 (0 - 1) / 2 不是 -1，到堆顶必须停下 */
+    while(i > 0) {
+        size_t j = (i - 1) / 2;
         if(heap_[j] < heap_[i]) { break; }
         SwapNode_(i, j);
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
@@ -62,8 +62,9 @@ void HeapTimer::doWork(int id) {
     }
     size_t i = ref_[id];
     TimerNode node = heap_[i];
-    node.cb();
+    /* 先删除再回调，回调里可能为同一个 id 重新添加 */
     del_(i);
+    node.cb();
 }
 
 void HeapTimer::del_(size_t index) {
@@ -84,9 +85,14 @@ void HeapTimer::del_(size_t index) {
     heap_.pop_back();
 }
 
+void HeapTimer::cancel(int id) {
+    if(ref_.count(id) == 0) { return; }
+    del_(ref_[id]);
+}
+
 void HeapTimer::adjust(int id, int timeout) {
     /* 调整指定id的结点 */
-    assert(!heap_.empty() && ref_.count(id) > 0);
+    if(ref_.count(id) == 0) { return; }
     heap_[ref_[id]].expires = Clock::now() + MS(timeout);;
     siftdown_(ref_[id], heap_.size());
 }
@@ -101,8 +107,8 @@ void HeapTimer::tick() {
         if(std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0) { 
             break; 
         }
-        node.cb();
         pop();
+        node.cb();
     }
 }
 
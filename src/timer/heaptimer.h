@@ -10,11 +10,7 @@
 #include <assert.h> 
 #include <chrono>
 #include "../log/log.h"
-
-typedef std::function<void()> TimeoutCallBack;
-typedef std::chrono::high_resolution_clock Clock;
-typedef std::chrono::milliseconds MS;
-typedef Clock::time_point TimeStamp;
+#include "timer.h"
 
 struct TimerNode {
     int id;
@@ -24,25 +20,29 @@ struct TimerNode {
         return expires < t.expires;
     }
 };
-class HeapTimer {
+class HeapTimer : public Timer {
 public:
     HeapTimer() { heap_.reserve(64); }
 
     ~HeapTimer() { clear(); }
     
-    void adjust(int id, int newExpires);
+    void adjust(int id, int newExpires) override;
+
+    void add(int id, int timeOut, const TimeoutCallBack& cb) override;
 
-    void add(int id, int timeOut, const TimeoutCallBack& cb);
+    void cancel(int id) override;
 
     void doWork(int id);
 
-    void clear();
+    void clear() override;
 
-    void tick();
+    void tick() override;
 
     void pop();
 
-    int GetNextTick();
+    int GetNextTick() override;
+
+    const char* Name() const override { return "heap"; }
 
 private:
     void del_(size_t i);
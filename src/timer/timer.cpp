@@ -0,0 +1,10 @@
+#include "timer.h"
+#include "heaptimer.h"
+#include "timingwheel.h"
+
+Timer* Timer::NewTimer(int kind, int maxId) {
+    if(kind == WHEEL) {
+        return new TimingWheel(maxId);
+    }
+    return new HeapTimer();
+}
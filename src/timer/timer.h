@@ -0,0 +1,53 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <functional>
+#include <chrono>
+#include <stdint.h>
+
+typedef std::function<void()> TimeoutCallBack;
+/* 定时器只比较时间差，用单调时钟，不受系统改时间影响 */
+typedef std::chrono::steady_clock Clock;
+typedef std::chrono::milliseconds MS;
+typedef Clock::time_point TimeStamp;
+
+/* 单调时钟的毫秒数，用于连接的最后活跃时间 */
+inline int64_t NowMs() {
+    return std::chrono::duration_cast<MS>(Clock::now().time_since_epoch()).count();
+}
+
+/* 连接超时定时器接口，id 为连接 fd，由 WebServer 启动时选择具体实现。
+ * 非线程安全，只在所属的事件循环线程中调用 */
+class Timer {
+public:
+    enum KIND {
+        HEAP = 0,   // 小根堆，毫秒精度
+        WHEEL,      // 分层时间轮，精度为一个 tick，增删改 O(1)
+    };
+
+    virtual ~Timer() = default;
+
+    /* id 已存在时更新超时时间和回调 */
+    virtual void add(int id, int timeOut, const TimeoutCallBack& cb) = 0;
+
+    /* 从现在起延后到 newExpires 毫秒后超时，id 不存在时忽略 */
+    virtual void adjust(int id, int newExpires) = 0;
+
+    /* 删除且不触发回调，id 不存在时忽略 */
+    virtual void cancel(int id) = 0;
+
+    /* 触发所有已超时的回调 */
+    virtual void tick() = 0;
+
+    /* 先 tick()，再返回距下次需要 tick 的毫秒数，没有定时器时返回 -1 */
+    virtual int GetNextTick() = 0;
+
+    virtual void clear() = 0;
+
+    virtual const char* Name() const = 0;
+
+    /* maxId 为预分配的 id 个数(时间轮按 id 直接下标)，超出时按需翻倍扩容 */
+    static Timer* NewTimer(int kind, int maxId);
+};
+
+#endif //TIMER_H
@@ -0,0 +1,160 @@
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(int maxId, int tickMs)
+    : tickMs_(tickMs > 0 ? tickMs : TICK_MS), start_(Clock::now()), curTick_(0), count_(0),
+      nodes_(maxId > 0 ? maxId : 1) {
+    for(auto& level: heads_) {
+        for(int& head: level) { head = -1; }
+    }
+}
+
+uint64_t TimingWheel::NowTick_() const {
+    return std::chrono::duration_cast<MS>(Clock::now() - start_).count() / tickMs_;
+}
+
+uint64_t TimingWheel::ExpireTick_(int timeout) const {
+    /* 向上取整，保证不早于 timeout 触发 */
+    uint64_t ticks = timeout > 0 ? (static_cast<uint64_t>(timeout) + tickMs_ - 1) / tickMs_ : 0;
+    return NowTick_() + ticks;
+}
+
+TimingWheel::Node& TimingWheel::NodeAt_(int id) {
+    assert(id >= 0);
+    if(static_cast<size_t>(id) >= nodes_.size()) {
+        nodes_.resize(std::max(static_cast<size_t>(id) + 1, nodes_.size() * 2));
+    }
+    return nodes_[id];
+}
+
+void TimingWheel::Insert_(int id, uint64_t earliest) {
+    Node& node = nodes_[id];
+    /* 已过期的放到还会处理的最早一格 */
+    uint64_t expire = node.expire > earliest ? node.expire : earliest;
+    uint64_t delta = expire - curTick_;
+    if(delta > MAX_TICKS) {
+        expire = curTick_ + MAX_TICKS;
+        delta = MAX_TICKS;
+    }
+    int level = 0;
+    while(level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (expire >> (SLOT_BITS * level)) & SLOT_MASK;
+    node.level = level;
+    node.slot = slot;
+    node.prev = -1;
+    node.next = heads_[level][slot];
+    if(node.next >= 0) { nodes_[node.next].prev = id; }
+    heads_[level][slot] = id;
+}
+
+void TimingWheel::Unlink_(int id) {
+    Node& node = nodes_[id];
+    assert(node.level >= 0);
+    if(node.prev >= 0) { nodes_[node.prev].next = node.next; }
+    else { heads_[node.level][node.slot] = node.next; }
+    if(node.next >= 0) { nodes_[node.next].prev = node.prev; }
+    node.prev = node.next = -1;
+    node.level = -1;
+}
+
+void TimingWheel::add(int id, int timeout, const TimeoutCallBack& cb) {
+    Node& node = NodeAt_(id);
+    if(node.level >= 0) { Unlink_(id); }
+    else { count_++; }
+    node.expire = ExpireTick_(timeout);
+    node.cb = cb;
+    Insert_(id, curTick_ + 1);
+}
+
+void TimingWheel::adjust(int id, int timeout) {
+    if(id < 0 || static_cast<size_t>(id) >= nodes_.size() || nodes_[id].level < 0) { return; }
+    Node& node = nodes_[id];
+    uint64_t expire = ExpireTick_(timeout);
+    /* 同一个 tick 内的刷新不用挪动 */
+    if(expire == node.expire) { return; }
+    Unlink_(id);
+    node.expire = expire;
+    Insert_(id, curTick_ + 1);
+}
+
+void TimingWheel::cancel(int id) {
+    if(id < 0 || static_cast<size_t>(id) >= nodes_.size() || nodes_[id].level < 0) { return; }
+    Unlink_(id);
+    nodes_[id].cb = nullptr;
+    count_--;
+}
+
+/* 上层一格转完一圈下层后，把这一格的节点按剩余时间重新分到下层。
+ * 下放发生在 Expire_ 之前，正好在 curTick_ 到期的节点落到第 0 层当前格，本次 tick 触发 */
+void TimingWheel::Cascade_(int level) {
+    int slot = (curTick_ >> (SLOT_BITS * level)) & SLOT_MASK;
+    int id = heads_[level][slot];
+    heads_[level][slot] = -1;
+    while(id >= 0) {
+        int next = nodes_[id].next;
+        nodes_[id].level = -1;
+        Insert_(id, curTick_);
+        id = next;
+    }
+}
+
+void TimingWheel::Expire_() {
+    int slot = curTick_ & SLOT_MASK;
+    /* 回调里可能增删定时器，每次都从表头取 */
+    while(heads_[0][slot] >= 0) {
+        int id = heads_[0][slot];
+        Unlink_(id);
+        count_--;
+        TimeoutCallBack cb;
+        cb.swap(nodes_[id].cb);
+        if(cb) { cb(); }
+    }
+}
+
+void TimingWheel::tick() {
+    uint64_t now = NowTick_();
+    while(curTick_ < now) {
+        if(count_ == 0) {
+            curTick_ = now;
+            break;
+        }
+        curTick_++;
+        /* 高层先下放，落到下层当前格的节点随后一并下放或触发 */
+        for(int level = LEVELS - 1; level > 0; level--) {
+            if((curTick_ & ((1ull << (SLOT_BITS * level)) - 1)) == 0) {
+                Cascade_(level);
+            }
+        }
+        Expire_();
+    }
+}
+
+int TimingWheel::GetNextTick() {
+    tick();
+    if(count_ == 0) { return -1; }
+    /* 找第 0 层最近的非空格，最远看到下一次下放为止 */
+    uint64_t limit = SLOTS - (curTick_ & SLOT_MASK);
+    uint64_t next = limit;
+    for(uint64_t d = 1; d < limit; d++) {
+        if(heads_[0][(curTick_ + d) & SLOT_MASK] >= 0) {
+            next = d;
+            break;
+        }
+    }
+    int64_t elapsed = std::chrono::duration_cast<MS>(Clock::now() - start_).count();
+    int64_t ms = static_cast<int64_t>(curTick_ + next) * tickMs_ - elapsed;
+    return ms > 0 ? static_cast<int>(ms) : 0;
+}
+
+void TimingWheel::clear() {
+    for(auto& level: heads_) {
+        for(int& head: level) { head = -1; }
+    }
+    for(auto& node: nodes_) {
+        node.prev = node.next = -1;
+        node.level = -1;
+        node.cb = nullptr;
+    }
+    count_ = 0;
+}
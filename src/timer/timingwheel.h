@@ -0,0 +1,75 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <assert.h>
+
+#include "timer.h"
+
+/* 分层时间轮: 4 层 x 64 槽，每层一格是下一层一整圈，
+ * tick 为 TICK_MS 毫秒时可表示约 2^24 个 tick 的超时。
+ * 定时器节点按 id(连接 fd)直接存放在数组里，槽内用下标串成双向链表，
+ * 增、删、改都是 O(1)，不需要哈希表。
+ * 超时时间按 tick 向上取整，触发误差不超过一个 tick；
+ * 同一 tick 内的多次 adjust 落在同一格，直接跳过。 */
+class TimingWheel : public Timer {
+public:
+    explicit TimingWheel(int maxId = 1024, int tickMs = TICK_MS);
+
+    ~TimingWheel() { clear(); }
+
+    void add(int id, int timeOut, const TimeoutCallBack& cb) override;
+
+    void adjust(int id, int newExpires) override;
+
+    void cancel(int id) override;
+
+    void tick() override;
+
+    int GetNextTick() override;
+
+    void clear() override;
+
+    const char* Name() const override { return "wheel"; }
+
+    size_t Size() const { return count_; }
+
+private:
+    static const int TICK_MS = 10;
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int SLOT_MASK = SLOTS - 1;
+    static const uint64_t MAX_TICKS = (1ull << (SLOT_BITS * LEVELS)) - 1;
+
+    struct Node {
+        int prev;
+        int next;
+        int16_t level;      // -1 表示不在轮上
+        int16_t slot;
+        uint64_t expire;    // 到期的 tick
+        TimeoutCallBack cb;
+
+        Node(): prev(-1), next(-1), level(-1), slot(0), expire(0) {}
+    };
+
+    uint64_t NowTick_() const;
+    uint64_t ExpireTick_(int timeout) const;
+    Node& NodeAt_(int id);
+    /* earliest: 还会被 Expire_ 处理的最早 tick */
+    void Insert_(int id, uint64_t earliest);
+    void Unlink_(int id);
+    void Cascade_(int level);
+    void Expire_();
+
+    int tickMs_;
+    TimeStamp start_;
+    uint64_t curTick_;          // 已处理到的 tick
+    size_t count_;
+    std::vector<Node> nodes_;   // 下标即 id
+    int heads_[LEVELS][SLOTS];  // 各槽链表头，-1 为空
+};
+
+#endif //TIMING_WHEEL_H
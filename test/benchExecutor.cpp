@@ -0,0 +1,168 @@
+/* 执行器吞吐与每任务内存分配次数对比:
+ * 旧的 std::function + std::queue 线程池 vs ThreadPool vs WorkStealPool
+ * 编译: cd build && make bench，运行: ../bin/benchExecutor [线程数] [任务数] */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <functional>
+#include <new>
+
+#include "../src/pool/threadpool.h"
+#include "../src/pool/workstealpool.h"
+
+using namespace std;
+
+/* 统计全局 operator new 调用次数 */
+static atomic<long> allocs(0);
+
+void* operator new(size_t size) {
+    allocs.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if(!p) { throw bad_alloc(); }
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/* 旧实现: 每次 AddTask 构造 std::function 并压入 std::queue */
+class LegacyPool : public Executor {
+public:
+    explicit LegacyPool(size_t threadCount): pool_(make_shared<Pool>()) {
+        for(size_t i = 0; i < threadCount; i++) {
+            thread([pool = pool_] {
+                unique_lock<mutex> locker(pool->mtx);
+                while(true) {
+                    if(!pool->tasks.empty()) {
+                        auto task = std::move(pool->tasks.front());
+                        pool->tasks.pop();
+                        locker.unlock();
+                        task();
+                        locker.lock();
+                    }
+                    else if(pool->isClosed) break;
+                    else pool->cond.wait(locker);
+                }
+            }).detach();
+        }
+    }
+    ~LegacyPool() {
+        {
+            lock_guard<mutex> locker(pool_->mtx);
+            pool_->isClosed = true;
+        }
+        pool_->cond.notify_all();
+    }
+    /* 基准只用下面的 Submit，保持旧接口的 std::function 开销 */
+    void AddTask(Task task) override { abort(); }
+    const char* Name() const override { return "std::function"; }
+    size_t QueueSize() const override {
+        lock_guard<mutex> locker(pool_->mtx);
+        return pool_->tasks.size();
+    }
+
+    template<class F>
+    void Submit(F&& task) {
+        {
+            lock_guard<mutex> locker(pool_->mtx);
+            pool_->tasks.emplace(std::forward<F>(task));
+        }
+        pool_->cond.notify_one();
+    }
+
+private:
+    struct Pool {
+        mutex mtx;
+        condition_variable cond;
+        bool isClosed = false;
+        queue<function<void()>> tasks;
+    };
+    shared_ptr<Pool> pool_;
+};
+
+static atomic<long> done(0);
+
+/* 模拟一次短小的读写回调，提交方式与 WebServer::DealRead_ 相同: bind 成员函数 + 连接 + 代数 */
+struct Conn {
+    void OnRead(Conn* client, uint32_t gen) {
+        volatile int x = 0;
+        for(int i = 0; i < 64; i++) { x = x + i; }
+        done.fetch_add(1, memory_order_relaxed);
+    }
+};
+static Conn conn;
+
+static void WaitDone(long n) {
+    while(done.load(memory_order_relaxed) < n) { this_thread::yield(); }
+}
+
+template<class Submit>
+static double Run(long n, Submit submit, double* allocPerTask) {
+    done = 0;
+    long allocStart = allocs.load();
+    auto start = chrono::steady_clock::now();
+    for(long i = 0; i < n; i++) {
+        submit(bind(&Conn::OnRead, &conn, &conn, static_cast<uint32_t>(i)));
+    }
+    WaitDone(n);
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    *allocPerTask = static_cast<double>(allocs.load() - allocStart) / n;
+    return n / sec;
+}
+
+/* 任务内再提交子任务 */
+static double FanOut(Executor* exec, long n) {
+    const int FAN = 64;
+    done = 0;
+    auto start = chrono::steady_clock::now();
+    for(long i = 0; i < n / FAN; i++) {
+        exec->AddTask([exec] {
+            for(int j = 0; j < FAN; j++) { exec->AddTask(bind(&Conn::OnRead, &conn, &conn, 0u)); }
+        });
+    }
+    WaitDone(n / FAN * FAN);
+    return n / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* 每次只提交一个任务并等它完成，衡量唤醒延迟 */
+static double PingPong(Executor* exec, long n) {
+    done = 0;
+    auto start = chrono::steady_clock::now();
+    for(long i = 0; i < n; i++) {
+        exec->AddTask(bind(&Conn::OnRead, &conn, &conn, 0u));
+        WaitDone(i + 1);
+    }
+    return n / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 6;
+    long n = argc > 2 ? atol(argv[2]) : 2000000;
+    printf("%d threads, %ld tasks, sizeof(Task) %d\n", threads, n, (int)sizeof(Task));
+    printf("  %-14s %14s %12s %14s %14s\n", "executor", "inject/s", "alloc/task", "fan-out/s", "ping-pong/s");
+    {
+        LegacyPool legacy(threads);
+        double alloc;
+        double inject = Run(n, [&legacy](decltype(bind(&Conn::OnRead, &conn, &conn, 0u)) t) {
+            legacy.Submit(std::move(t));
+        }, &alloc);
+        printf("  %-14s %14.0f %12.2f %14s %14s\n", legacy.Name(), inject, alloc, "-", "-");
+    }
+    for(int kind: { Executor::THREAD_POOL, Executor::WORK_STEALING }) {
+        unique_ptr<Executor> exec(Executor::NewExecutor(kind, threads));
+        /* 先跑一轮让队列、节点池扩到稳定大小 */
+        double alloc;
+        Run(n / 10, [&exec](Task t) { exec->AddTask(std::move(t)); }, &alloc);
+        double inject = Run(n, [&exec](Task t) { exec->AddTask(std::move(t)); }, &alloc);
+        double fanOut = FanOut(exec.get(), n);
+        double pingPong = PingPong(exec.get(), n / 50);
+        printf("  %-14s %14.0f %12.2f %14.0f %14.0f\n", exec->Name(), inject, alloc, fanOut, pingPong);
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+/* 多线程写日志吞吐对比: 旧的 BlockDeque 日志 vs 同步 / 无锁环形队列 / 线程本地缓冲
+ * 每种引擎在单独的子进程里跑(Log 是单例，写线程只起一次)，日志写到 ./benchlog/ 下。
+ * "workers" 是工作线程看到的速度，"drained" 包含写线程把剩余内容落盘、进程退出的时间。
+ * 编译: cd build && make bench，运行: ../bin/benchLog [线程数] [每线程行数] */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/log/log.h"
+
+using namespace std;
+
+/* 旧实现: 全局锁内格式化，每行拷贝成 string 入阻塞队列并唤醒写线程，写线程逐行 fputs，每行 fflush */
+class LegacyLog {
+public:
+    LegacyLog(const char* fileName, size_t capacity)
+        : fp_(fopen(fileName, "a")), capacity_(capacity), closed_(false) {
+        writer_ = thread([this] { AsyncWrite_(); });
+    }
+    ~LegacyLog() {
+        {
+            lock_guard<mutex> locker(dequeMtx_);
+            closed_ = true;
+        }
+        condConsumer_.notify_all();
+        writer_.join();
+        fclose(fp_);
+    }
+
+    void write(int level, const char* format, ...) {
+        struct timeval now = {0, 0};
+        gettimeofday(&now, nullptr);
+        struct tm t;
+        localtime_r(&now.tv_sec, &t);
+        va_list vaList;
+
+        unique_lock<mutex> locker(mtx_);
+        int n = snprintf(buff_.BeginWrite(), 128, "%d-%02d-%02d %02d:%02d:%02d.%06ld ",
+                    t.tm_year + 1900, t.tm_mon + 1, t.tm_mday,
+                    t.tm_hour, t.tm_min, t.tm_sec, now.tv_usec);
+        buff_.HasWritten(n);
+        buff_.Append(level == 1 ? "[info] : " : "[debug]: ", 9);
+        va_start(vaList, format);
+        int m = vsnprintf(buff_.BeginWrite(), buff_.WritableBytes(), format, vaList);
+        va_end(vaList);
+        buff_.HasWritten(m);
+        buff_.Append("\n\0", 2);
+        /* 队列满时就地 fputs，与旧实现一致 */
+        if(!TryPush_(buff_)) {
+            fputs(buff_.Peek(), fp_);
+        }
+        buff_.RetrieveAll();
+    }
+
+    void flush() {
+        condConsumer_.notify_one();
+        lock_guard<mutex> locker(mtx_);
+        fflush(fp_);
+    }
+
+private:
+    bool TryPush_(Buffer& buff) {
+        lock_guard<mutex> locker(dequeMtx_);
+        if(deq_.size() >= capacity_) { return false; }
+        deq_.push_back(buff.RetrieveAllToStr());
+        condConsumer_.notify_one();
+        return true;
+    }
+
+    void AsyncWrite_() {
+        string line;
+        while(true) {
+            {
+                unique_lock<mutex> locker(dequeMtx_);
+                condConsumer_.wait(locker, [this] { return !deq_.empty() || closed_; });
+                if(deq_.empty()) { return; }
+                line = std::move(deq_.front());
+                deq_.pop_front();
+            }
+            lock_guard<mutex> locker(mtx_);
+            fputs(line.c_str(), fp_);
+        }
+    }
+
+    FILE* fp_;
+    Buffer buff_;
+    mutex mtx_;
+
+    deque<string> deq_;
+    size_t capacity_;
+    bool closed_;
+    mutex dequeMtx_;
+    condition_variable condConsumer_;
+    thread writer_;
+};
+
+static double Produce(int threads, int lines, const function<void(int, int)>& logOnce) {
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for(int t = 0; t < threads; t++) {
+        workers.emplace_back([t, lines, &logOnce] {
+            for(int i = 0; i < lines; i++) { logOnce(t, i); }
+        });
+    }
+    for(auto& w: workers) { w.join(); }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* 在子进程里跑一种引擎，返回包含落盘与退出的总耗时 */
+static double RunChild(const char* name, long total, const function<double()>& body) {
+    auto start = chrono::steady_clock::now();
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid == 0) {
+        double sec = body();
+        printf("  %-14s workers %10.0f lines/s", name, total / sec);
+        fflush(stdout);
+        exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("   drained %10.0f lines/s\n", total / sec);
+    return sec;
+}
+
+static double RunEngine(const char* name, int threads, int lines, int queueSize, int engine) {
+    string dir = string("./benchlog/") + name;
+    return RunChild(name, (long)threads * lines, [&] {
+        Log::Instance()->init(1, dir.c_str(), ".log", queueSize, engine);
+        return Produce(threads, lines, [](int t, int i) {
+            LOG_INFO("worker %d request %d GET /index.html 200 %s", t, i, "keep-alive");
+        });
+    });
+}
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 6;
+    int lines = argc > 2 ? atoi(argv[2]) : 200000;
+    mkdir("./benchlog", 0777);
+    printf("%d threads x %d lines\n", threads, lines);
+
+    double legacy = RunChild("legacy", (long)threads * lines, [&] {
+        mkdir("./benchlog/legacy", 0777);
+        LegacyLog log("./benchlog/legacy/legacy.log", 1024);
+        return Produce(threads, lines, [&log](int t, int i) {
+            log.write(1, "worker %d request %d GET /index.html 200 %s", t, i, "keep-alive");
+            log.flush();
+        });
+    });
+    RunEngine("sync", threads, lines, 0, Log::RING);
+    double ring = RunEngine("ring", threads, lines, 1024, Log::RING);
+    double buffer = RunEngine("thread-buffer", threads, lines, 1024, Log::THREAD_BUFFER);
+    printf("  speedup vs legacy: ring %.1fx, thread buffer %.1fx\n", legacy / ring, legacy / buffer);
+    return 0;
+}
@@ -0,0 +1,102 @@
+/* 请求解析吞吐对比: 旧的 regex 逐行解析 vs HttpRequest 状态机
+ * 编译: cd build && make bench，运行: ../bin/benchParser [次数] */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <regex>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../src/buffer/buffer.h"
+#include "../src/http/httprequest.h"
+
+using namespace std;
+
+static const char* REQUESTS[] = {
+    "GET / HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "Connection: keep-alive\r\n\r\n",
+
+    "GET /picture.html HTTP/1.1\r\n"
+    "Host: 127.0.0.1:1316\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: http://127.0.0.1:1316/index.html\r\n"
+    "Cookie: session=6b1f3c2a9d; theme=dark\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Connection: keep-alive\r\n\r\n",
+};
+
+/* 旧实现: 每行拷贝成 string，每行现场构造 regex */
+struct RegexParser {
+    string method, path, version;
+    unordered_map<string, string> header;
+
+    bool parse(Buffer& buff) {
+        const char CRLF[] = "\r\n";
+        int state = 0;
+        while(buff.ReadableBytes() && state != 2) {
+            const char* lineEnd = search(buff.Peek(), buff.BeginWriteConst(), CRLF, CRLF + 2);
+            string line(buff.Peek(), lineEnd);
+            if(state == 0) {
+                regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
+                smatch subMatch;
+                if(!regex_match(line, subMatch, patten)) { return false; }
+                method = subMatch[1];
+                path = subMatch[2];
+                version = subMatch[3];
+                state = 1;
+            } else {
+                regex patten("^([^:]*): ?(.*)$");
+                smatch subMatch;
+                if(regex_match(line, subMatch, patten)) {
+                    header[subMatch[1]] = subMatch[2];
+                } else {
+                    state = 2;
+                }
+            }
+            if(lineEnd == buff.BeginWrite()) { break; }
+            buff.RetrieveUntil(lineEnd + 2);
+        }
+        return true;
+    }
+};
+
+template<class F>
+static double Run(const char* name, const string& req, int n, F parseOnce) {
+    Buffer buff(4096);
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < n; i++) {
+        buff.Append(req);
+        if(!parseOnce(buff)) {
+            printf("%s: parse failed\n", name);
+            exit(1);
+        }
+        buff.RetrieveAll();
+    }
+    double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("  %-8s %10.0f req/s  %8.1f MB/s\n", name, n / sec, n * req.size() / sec / 1e6);
+    return n / sec;
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 200000;
+    for(const char* r: REQUESTS) {
+        string req(r);
+        printf("request %d bytes, %d iterations\n", (int)req.size(), n);
+        double oldRate = Run("regex", req, n / 20, [](Buffer& buff) {
+            RegexParser p;
+            return p.parse(buff);
+        });
+        HttpRequest request;
+        double newRate = Run("state", req, n, [&request](Buffer& buff) {
+            request.Init();
+            return request.parse(buff) == HttpRequest::COMPLETE;
+        });
+        printf("  speedup  %.1fx\n", newRate / oldRate);
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+/* 连接超时定时器开销对比: 每次读写都 adjust(旧做法) vs 只记最后活跃时间、到期再核对
+ * 分别跑 HeapTimer 和 TimingWheel，统计每个请求的定时器操作次数和每个事件的耗时
+ * 编译: cd build && make bench，运行: ../bin/benchTimer [连接数] [事件数] */
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "../src/timer/heaptimer.h"
+#include "../src/timer/timingwheel.h"
+
+using namespace std;
+
+struct Sim {
+    unique_ptr<Timer> timer;
+    bool lazy;
+    int timeoutMS;
+    int64_t nowMs;
+    vector<int64_t> lastActive;
+    long ops = 0;       // add + adjust
+    long closed = 0;
+
+    void Expired(int fd) {
+        if(lazy) {
+            int64_t idle = NowMs() - lastActive[fd];
+            if(idle < timeoutMS) {
+                ops++;
+                timer->add(fd, static_cast<int>(timeoutMS - idle), bind(&Sim::Expired, this, fd));
+                return;
+            }
+        }
+        closed++;
+    }
+
+    void Event(int fd) {
+        if(lazy) {
+            lastActive[fd] = nowMs;
+        } else {
+            ops++;
+            timer->adjust(fd, timeoutMS);
+        }
+    }
+};
+
+static void Run(int kind, bool lazy, int conns, long events, int timeoutMS) {
+    Sim sim;
+    sim.timer.reset(Timer::NewTimer(kind, conns));
+    sim.lazy = lazy;
+    sim.timeoutMS = timeoutMS;
+    sim.nowMs = NowMs();
+    sim.lastActive.assign(conns, sim.nowMs);
+    for(int fd = 0; fd < conns; fd++) {
+        sim.timer->add(fd, timeoutMS, bind(&Sim::Expired, &sim, fd));
+    }
+    sim.ops = 0;
+
+    /* 每 32 个事件算一轮事件循环: 取一次时间、处理一次到期 */
+    const int BATCH = 32;
+    auto start = Clock::now();
+    for(long i = 0; i < events; i++) {
+        if(i % BATCH == 0) {
+            sim.timer->GetNextTick();
+            sim.nowMs = NowMs();
+        }
+        sim.Event(static_cast<int>((i * 7919) % conns));
+    }
+    double sec = chrono::duration<double>(Clock::now() - start).count();
+    /* 一个请求算一次读一次写 */
+    printf("  %-6s %-6s %10.1f ns/event %8.3f ops/request  closed %ld\n", sim.timer->Name(),
+           lazy ? "lazy" : "eager", sec * 1e9 / events, sim.ops / (events / 2.0), sim.closed);
+}
+
+int main(int argc, char** argv) {
+    int conns = argc > 1 ? atoi(argv[1]) : 100000;
+    long events = argc > 2 ? atol(argv[2]) : 4000000;
+    /* 长超时: 热路径上的纯开销；短超时: 定时器在运行期间反复到期，惰性方式要补挂 */
+    struct { int conns; int timeoutMS; } cases[] = { { conns, 60000 }, { conns / 10, 20 } };
+    for(auto& c: cases) {
+        printf("%d connections, %ld events, timeout %dms\n", c.conns, events, c.timeoutMS);
+        for(int kind: { Timer::HEAP, Timer::WHEEL }) {
+            Run(kind, false, c.conns, events, c.timeoutMS);
+            Run(kind, true, c.conns, events, c.timeoutMS);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+/* 二进制访问日志解码: 把 AccessLog 写出的分段文件转成文本或 CSV
+ * 编译: cd build && make tools
+ * 运行: ../bin/decodeAccessLog [-c] log/access_*.bin   (-c 输出 CSV，默认文本) */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <arpa/inet.h>    // inet_ntop
+
+#include "../src/log/accessrecord.h"
+
+using namespace std;
+
+static const char* METHOD_NAMES[] = { "-", "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS", "PATCH" };
+static const char* TYPE_NAMES[] = { "end", "path", "connect", "request", "close" };
+
+static string FormatTime(int64_t us) {
+    time_t sec = us / 1000000;
+    struct tm t;
+    localtime_r(&sec, &t);
+    char buf[80];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d.%06ld",
+            t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, (long)(us % 1000000));
+    return buf;
+}
+
+/* CSV 字段: 含逗号、引号或换行时加引号，引号写两次 */
+static string CsvField(const string& s) {
+    if(s.find_first_of(",\"\r\n") == string::npos) { return s; }
+    string out = "\"";
+    for(char c: s) {
+        if(c == '"') { out += '"'; }
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+static void PrintRecord(const AccessRecord& rec, const unordered_map<uint32_t, string>& paths, bool csv) {
+    char ip[INET_ADDRSTRLEN] = "-";
+    struct in_addr addr;
+    addr.s_addr = rec.peerIp;
+    inet_ntop(AF_INET, &addr, ip, sizeof(ip));
+    string time = FormatTime(rec.timeUs);
+    const char* method = rec.method < sizeof(METHOD_NAMES) / sizeof(METHOD_NAMES[0]) ? METHOD_NAMES[rec.method] : "-";
+    string path = "-";
+    if(rec.type == AccessRecord::REQUEST && rec.pathId) {
+        auto it = paths.find(rec.pathId);
+        path = it != paths.end() ? it->second : "#" + to_string(rec.pathId);
+        if(path.empty()) { path = "-"; }
+    }
+
+    if(csv) {
+        if(rec.type == AccessRecord::REQUEST) {
+            printf("%s,%s,%d,%s,%u,%s,%s,%u,%llu,%u,\n", time.c_str(), TYPE_NAMES[rec.type], rec.fd, ip,
+                    rec.peerPort, method, CsvField(path).c_str(), rec.status,
+                    (unsigned long long)rec.bytes, rec.latencyUs);
+        } else {
+            printf("%s,%s,%d,%s,%u,,,,,,%u\n", time.c_str(), TYPE_NAMES[rec.type], rec.fd, ip,
+                    rec.peerPort, rec.users);
+        }
+        return;
+    }
+    /* 连接进出与原来的文本日志同样的写法 */
+    switch(rec.type) {
+    case AccessRecord::CONNECT:
+        printf("%s Client[%d](%s:%u) in, userCount:%u\n", time.c_str(), rec.fd, ip, rec.peerPort, rec.users);
+        break;
+    case AccessRecord::CLOSE:
+        printf("%s Client[%d](%s:%u) quit, UserCount:%u\n", time.c_str(), rec.fd, ip, rec.peerPort, rec.users);
+        break;
+    default:
+        printf("%s Client[%d](%s:%u) %s %s %u %lluB %uus\n", time.c_str(), rec.fd, ip, rec.peerPort,
+                method, path.c_str(), rec.status, (unsigned long long)rec.bytes, rec.latencyUs);
+        break;
+    }
+}
+
+/* 返回解码的记录数，格式不对时返回 -1 */
+static long DecodeFile(const char* fileName, bool csv) {
+    FILE* fp = fopen(fileName, "rb");
+    if(!fp) {
+        fprintf(stderr, "%s: cannot open\n", fileName);
+        return -1;
+    }
+    AccessFileHeader header;
+    if(fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, ACCESS_LOG_MAGIC, sizeof(header.magic)) != 0
+        || header.version != ACCESS_LOG_VERSION || header.recordSize != ACCESS_RECORD_SIZE) {
+        fprintf(stderr, "%s: not an access log (or unsupported version)\n", fileName);
+        fclose(fp);
+        return -1;
+    }
+
+    unordered_map<uint32_t, string> paths;
+    AccessRecord rec;
+    long count = 0;
+    while(fread(&rec, sizeof(rec), 1, fp) == 1) {
+        if(rec.type == AccessRecord::END) { break; }   // 异常退出留下的未写区域
+        if(rec.type == AccessRecord::PATH) {
+            size_t blocks = (rec.pathLen + ACCESS_RECORD_SIZE - 1) / ACCESS_RECORD_SIZE;
+            vector<char> text(blocks * ACCESS_RECORD_SIZE);
+            if(blocks > 0 && fread(text.data(), ACCESS_RECORD_SIZE, blocks, fp) != blocks) {
+                fprintf(stderr, "%s: truncated path record\n", fileName);
+                break;
+            }
+            paths[rec.pathId].assign(text.data(), rec.pathLen);
+            continue;
+        }
+        if(rec.type > AccessRecord::CLOSE) {
+            fprintf(stderr, "%s: unknown record type %d at record %ld\n", fileName, rec.type, count);
+            break;
+        }
+        PrintRecord(rec, paths, csv);
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    vector<const char*> files;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--csv") == 0) { csv = true; }
+        else { files.push_back(argv[i]); }
+    }
+    if(files.empty()) {
+        fprintf(stderr, "usage: %s [-c|--csv] access_*.bin...\n", argv[0]);
+        return 2;
+    }
+    if(csv) {
+        printf("time,type,fd,ip,port,method,path,status,bytes,latency_us,users\n");
+    }
+    int ret = 0;
+    for(const char* file: files) {
+        if(DecodeFile(file, csv) < 0) { ret = 1; }
+    }
+    return ret;
+}